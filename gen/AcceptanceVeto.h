@@ -0,0 +1,91 @@
+#ifndef ACCEPTANCEVETO_H
+#define ACCEPTANCEVETO_H
+
+// Early rejection of events that cannot reach the analysis acceptance, before
+// hadronisation and decays are paid for. Selected by Analysis:vetoLevel:
+//   0  off
+//   1  process level: after the hard process, needs an outgoing parton
+//   2  parton level: after showers and MPI, needs a final-state parton
+// with |eta| < Analysis:vetoEtaMax and pT > Analysis:vetoPtMin.
+//
+// Analysis:vetoPtMin < 0 (the default) takes kVetoPtHatFraction of
+// PhaseSpace:pTHatMin, at least kTrackPtMin: the partons that make a jet near
+// the bin's pT-hat keep most of their pT through the shower, while the soft
+// partons of MPI and the shower that are found in almost every event do not
+// count. At process level the outgoing partons have pT = pT-hat, so there only
+// the eta window vetoes.
+//
+// Pythia generates a new event for every vetoed one and counts it as tried
+// but not accepted, so sigmaGen and nAccepted describe the accepted sample.
+// hVeto keeps our own count ("checked", "vetoed"; additive over threads and
+// jobs) so the vetoed fraction can be checked against sigmaGen.
+//
+// The veto only suits jet observables: inclusive track spectra also get
+// tracks from events whose hard partons are outside the acceptance.
+
+#include <algorithm>
+#include <cmath>
+#include <TH1.h>
+#include <Pythia8/Pythia.h>
+
+#include "JetAnalysis.h"
+
+static const double kVetoPtHatFraction = 0.5;
+
+enum VetoLevel
+{
+    kVetoOff = 0,
+    kVetoProcess = 1,
+    kVetoParton = 2
+};
+
+// Parton pT threshold of the veto: Analysis:vetoPtMin, or derived from the bin
+inline double vetoPtMin(Pythia8::Settings &settings)
+{
+    const double ptMin = settings.parm("Analysis:vetoPtMin");
+    if (ptMin >= 0.0) return ptMin;
+    return std::max(kTrackPtMin, kVetoPtHatFraction * settings.parm("PhaseSpace:pTHatMin"));
+}
+
+class AcceptanceVeto : public Pythia8::UserHooks
+{
+public:
+    AcceptanceVeto(int level, double etaMax, double ptMin) : fLevel(level), fEtaMax(etaMax), fPtMin(ptMin) {}
+
+    // Histogram counting the decisions, owned by the caller; a Pythia instance
+    // reused for another job gets that job's histogram
+    void setHistogram(TH1 *hVeto) { fVeto = hVeto; }
+
+    bool canVetoProcessLevel() override { return fLevel == kVetoProcess; }
+    bool doVetoProcessLevel(Pythia8::Event &process) override { return count(!inAcceptance(process)); }
+
+    bool canVetoPartonLevel() override { return fLevel == kVetoParton; }
+    bool doVetoPartonLevel(const Pythia8::Event &event) override { return count(!inAcceptance(event)); }
+
+private:
+    bool inAcceptance(const Pythia8::Event &event) const
+    {
+        for (int i = 0; i < event.size(); i++)
+        {
+            const Pythia8::Particle &p = event[i];
+            if (p.isFinal() && p.isParton() && p.pT() > fPtMin && std::fabs(p.eta()) < fEtaMax) return true;
+        }
+        return false;
+    }
+
+    bool count(bool veto)
+    {
+        if (!fVeto) return veto;
+        // Bins 1 and 2, labelled "checked" and "vetoed" by the booking
+        fVeto->Fill(0.5);
+        if (veto) fVeto->Fill(1.5);
+        return veto;
+    }
+
+    int fLevel;
+    double fEtaMax;
+    double fPtMin;
+    TH1 *fVeto = nullptr;
+};
+
+#endif
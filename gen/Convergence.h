@@ -0,0 +1,220 @@
+#ifndef CONVERGENCE_H
+#define CONVERGENCE_H
+
+// Early stop of a job once its statistics are good enough. With
+// --target-precision P the job watches one analysis histogram over a range
+// (--target-hist NAME[:LO:HI], e.g. hJetPt:20:100) and stops when the largest
+// relative error sqrt(sum w^2)/sum w of the bins in range is at most P; with
+// --max-seconds T it also stops after T seconds of wall time. The target is
+// per job: N such jobs of a bin merge to about P/sqrt(N).
+//
+// Every generation thread flushes its copy of the histogram each
+// kConvergenceCheckEvents events and publishes the bin sums of the range here;
+// the combined sums decide, and one atomic flag stops all threads. How many
+// events each thread finished then depends on timing, so a multi-threaded job
+// that stops early is no longer reproducible event by event.
+//
+// Written next to the histograms when a target is set (after hPerf/PerfTree):
+//   hConvergence      additive: jobs, reachedTarget, reachedBudget, eventsPlanned,
+//                     eventsGenerated
+//   ConvergenceTree   one entry per job: target, precision (final, < 0 if a bin
+//                     in range is empty), eventsPlanned, eventsGenerated, reason
+//                     (0 all events, 1 target, 2 wall-time budget)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <TDirectory.h>
+#include <TH1.h>
+#include <TTree.h>
+
+static const long kConvergenceCheckEvents = 200;
+
+enum ConvergenceReason
+{
+    kRanAllEvents = 0,
+    kReachedTarget = 1,
+    kReachedBudget = 2
+};
+
+struct ConvergenceTarget
+{
+    std::string histogram = "hJetPt";
+    double rangeMin = 0.0;
+    double rangeMax = -1.0; // <= rangeMin: the whole axis
+    double precision = 0.0; // 0 = no precision target
+    double maxSeconds = 0.0; // 0 = no wall-time budget
+
+    bool enabled() const { return precision > 0.0 || maxSeconds > 0.0; }
+};
+
+// Parses NAME or NAME:LO:HI into target; false on a malformed range.
+inline bool parseTargetHistogram(const std::string &spec, ConvergenceTarget &target)
+{
+    const size_t first = spec.find(':');
+    target.histogram = spec.substr(0, first);
+    if (first == std::string::npos) return !target.histogram.empty();
+    const size_t second = spec.find(':', first + 1);
+    if (second == std::string::npos) return false;
+    char *end = nullptr;
+    target.rangeMin = std::strtod(spec.c_str() + first + 1, &end);
+    if (end != spec.c_str() + second) return false;
+    target.rangeMax = std::strtod(spec.c_str() + second + 1, &end);
+    return !target.histogram.empty() && !*end && target.rangeMax > target.rangeMin;
+}
+
+// Outcome of one job, kept with its results until they are written.
+struct ConvergenceRow
+{
+    double target = 0.0;
+    double precision = -1.0;
+    long eventsPlanned = 0;
+    long eventsGenerated = 0;
+    int reason = kRanAllEvents;
+};
+
+class ConvergenceMonitor
+{
+public:
+    ConvergenceMonitor(const ConvergenceTarget &target, int nThreads)
+        : fTarget(target), fSumW(nThreads), fSumW2(nThreads),
+          fDeadline(std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                           std::chrono::duration<double>(target.maxSeconds)))
+    {
+    }
+
+    const ConvergenceTarget &target() const { return fTarget; }
+
+    bool stopRequested() const { return fReason.load(std::memory_order_relaxed) != kRanAllEvents; }
+
+    // Checks the wall-time budget; true once the job should stop for any reason.
+    bool shouldStop()
+    {
+        if (stopRequested()) return true;
+        if (fTarget.maxSeconds > 0.0 && std::chrono::steady_clock::now() >= fDeadline) requestStop(kReachedBudget);
+        return stopRequested();
+    }
+
+    void addPlanned(long events) { fPlanned.fetch_add(events, std::memory_order_relaxed); }
+
+    // Publishes thread iThread's copy of the watched histogram, flushed, and
+    // stops the job if the combined precision reached the target.
+    void update(int iThread, const TH1 &h)
+    {
+        const std::pair<int, int> bins = binRange(h);
+        std::lock_guard<std::mutex> lock(fMutex);
+        std::vector<double> &sumW = fSumW[iThread];
+        std::vector<double> &sumW2 = fSumW2[iThread];
+        sumW.assign(bins.second - bins.first + 1, 0.0);
+        sumW2.assign(sumW.size(), 0.0);
+        for (int bin = bins.first; bin <= bins.second; bin++)
+        {
+            const double error = h.GetBinError(bin);
+            sumW[bin - bins.first] = h.GetBinContent(bin);
+            sumW2[bin - bins.first] = error * error;
+        }
+        fPrecision = combinedPrecision();
+        if (fTarget.precision > 0.0 && fPrecision >= 0.0 && fPrecision <= fTarget.precision) requestStop(kReachedTarget);
+    }
+
+    ConvergenceRow row(long eventsGenerated) const
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        ConvergenceRow row;
+        row.target = fTarget.precision;
+        row.precision = fPrecision;
+        row.eventsPlanned = fPlanned.load(std::memory_order_relaxed);
+        row.eventsGenerated = eventsGenerated;
+        row.reason = fReason.load(std::memory_order_relaxed);
+        return row;
+    }
+
+private:
+    std::pair<int, int> binRange(const TH1 &h) const
+    {
+        if (fTarget.rangeMax <= fTarget.rangeMin) return std::make_pair(1, h.GetNbinsX());
+        const int first = std::max(1, h.GetXaxis()->FindFixBin(fTarget.rangeMin));
+        const int last = std::min(h.GetNbinsX(), h.GetXaxis()->FindFixBin(fTarget.rangeMax) - 1);
+        return std::make_pair(first, std::max(first, last));
+    }
+
+    // Largest relative error over the range, < 0 while a bin is still empty
+    double combinedPrecision() const
+    {
+        size_t nBins = 0;
+        for (const auto &sums : fSumW) nBins = std::max(nBins, sums.size());
+        double worst = 0.0;
+        for (size_t bin = 0; bin < nBins; bin++)
+        {
+            double sumW = 0.0, sumW2 = 0.0;
+            for (size_t iThread = 0; iThread < fSumW.size(); iThread++)
+            {
+                if (bin >= fSumW[iThread].size()) continue;
+                sumW += fSumW[iThread][bin];
+                sumW2 += fSumW2[iThread][bin];
+            }
+            if (sumW <= 0.0) return -1.0;
+            worst = std::max(worst, std::sqrt(sumW2) / sumW);
+        }
+        return nBins > 0 ? worst : -1.0;
+    }
+
+    void requestStop(int reason)
+    {
+        int none = kRanAllEvents;
+        fReason.compare_exchange_strong(none, reason, std::memory_order_relaxed);
+    }
+
+    ConvergenceTarget fTarget;
+    mutable std::mutex fMutex;
+    std::vector<std::vector<double>> fSumW; // per thread, bins of the range
+    std::vector<std::vector<double>> fSumW2;
+    double fPrecision = -1.0;
+    std::atomic<int> fReason{kRanAllEvents};
+    std::atomic<long> fPlanned{0};
+    std::chrono::steady_clock::time_point fDeadline;
+};
+
+inline void writeConvergence(TDirectory *dir, const std::vector<ConvergenceRow> &rows)
+{
+    TH1D hConvergence("hConvergence", "Convergence stop; ; value", 5, 0, 5);
+    hConvergence.SetDirectory(0);
+    const char *labels[] = {"jobs", "reachedTarget", "reachedBudget", "eventsPlanned", "eventsGenerated"};
+    for (int bin = 1; bin <= 5; bin++) hConvergence.GetXaxis()->SetBinLabel(bin, labels[bin - 1]);
+    for (const auto &row : rows)
+    {
+        hConvergence.AddBinContent(1, 1.0);
+        if (row.reason == kReachedTarget) hConvergence.AddBinContent(2, 1.0);
+        if (row.reason == kReachedBudget) hConvergence.AddBinContent(3, 1.0);
+        hConvergence.AddBinContent(4, row.eventsPlanned);
+        hConvergence.AddBinContent(5, row.eventsGenerated);
+    }
+    dir->WriteTObject(&hConvergence);
+
+    ConvergenceRow row;
+    double eventsPlanned = 0.0, eventsGenerated = 0.0;
+    dir->cd();
+    TTree tree("ConvergenceTree", "Convergence of each generation job");
+    tree.Branch("target", &row.target, "target/D");
+    tree.Branch("precision", &row.precision, "precision/D");
+    tree.Branch("eventsPlanned", &eventsPlanned, "eventsPlanned/D");
+    tree.Branch("eventsGenerated", &eventsGenerated, "eventsGenerated/D");
+    tree.Branch("reason", &row.reason, "reason/I");
+    for (const auto &entry : rows)
+    {
+        row = entry;
+        eventsPlanned = entry.eventsPlanned;
+        eventsGenerated = entry.eventsGenerated;
+        tree.Fill();
+    }
+    tree.Write();
+    tree.SetDirectory(0);
+}
+
+#endif
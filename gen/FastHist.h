@@ -0,0 +1,103 @@
+#ifndef FASTHIST_H
+#define FASTHIST_H
+
+// Fill-side accumulator for the per-track and per-jet histograms. TH1::Fill
+// is a virtual call plus a bin search and Sumw2 bookkeeping per entry; here a
+// fill is one multiply into contiguous counters of a uniform binning. The sums
+// are folded into the TH1 with flush(), before anything reads it (merge,
+// checkpoint, write), and two accumulators add up bin by bin.
+
+#include <cmath>
+#include <vector>
+#include <TH1.h>
+
+class FastHist1D
+{
+public:
+    // Same binning as h, which must have uniform bins
+    explicit FastHist1D(const TH1 &h)
+        : fNBins(h.GetNbinsX()), fMin(h.GetXaxis()->GetXmin()),
+          fScale(h.GetNbinsX() / (h.GetXaxis()->GetXmax() - h.GetXaxis()->GetXmin())), fSumW(fNBins + 2, 0.0),
+          fSumW2(fNBins + 2, 0.0)
+    {
+    }
+
+    void fill(double x, double w = 1.0)
+    {
+        // Bin 0 and nBins+1 are under- and overflow, as in TH1
+        const double pos = (x - fMin) * fScale;
+        int bin;
+        if (!(pos >= 0.0)) bin = 0; // also NaN, which TH1 puts in underflow
+        else if (pos >= fNBins) bin = fNBins + 1;
+        else bin = 1 + int(pos);
+        fSumW[bin] += w;
+        fSumW2[bin] += w * w;
+        fEntries++;
+        if (w != 1.0) fWeighted = true;
+        if (bin == 0 || bin == fNBins + 1) return;
+        // Statistics over the in-range fills only, like TH1::Fill
+        fStats[0] += w;
+        fStats[1] += w * w;
+        fStats[2] += w * x;
+        fStats[3] += w * x * x;
+    }
+
+    void add(const FastHist1D &other)
+    {
+        for (size_t i = 0; i < fSumW.size(); i++)
+        {
+            fSumW[i] += other.fSumW[i];
+            fSumW2[i] += other.fSumW2[i];
+        }
+        for (int i = 0; i < 4; i++) fStats[i] += other.fStats[i];
+        fEntries += other.fEntries;
+        fWeighted = fWeighted || other.fWeighted;
+    }
+
+    // Adds the accumulated fills to h and starts over.
+    void flush(TH1 &h)
+    {
+        if (fEntries == 0) return;
+        double stats[4] = {};
+        h.GetStats(stats);
+        const double entries = h.GetEntries();
+        // Sumw2 on unit weights is implicit, as for TH1::Fill
+        const bool errors = fWeighted || h.GetSumw2N() > 0;
+        if (errors && h.GetSumw2N() == 0) h.Sumw2();
+        for (int bin = 0; bin <= fNBins + 1; bin++)
+        {
+            if (fSumW[bin] == 0.0 && fSumW2[bin] == 0.0) continue;
+            h.SetBinContent(bin, h.GetBinContent(bin) + fSumW[bin]);
+            if (errors)
+            {
+                const double error = h.GetBinError(bin);
+                h.SetBinError(bin, std::sqrt(error * error + fSumW2[bin]));
+            }
+        }
+        for (int i = 0; i < 4; i++) stats[i] += fStats[i];
+        h.PutStats(stats);
+        h.SetEntries(entries + fEntries);
+        reset();
+    }
+
+    void reset()
+    {
+        fSumW.assign(fSumW.size(), 0.0);
+        fSumW2.assign(fSumW2.size(), 0.0);
+        for (double &stat : fStats) stat = 0.0;
+        fEntries = 0;
+        fWeighted = false;
+    }
+
+private:
+    int fNBins;
+    double fMin;
+    double fScale; // bins per unit of x
+    std::vector<double> fSumW;
+    std::vector<double> fSumW2;
+    double fStats[4] = {}; // sum w, w^2, w*x, w*x^2
+    long fEntries = 0;
+    bool fWeighted = false;
+};
+
+#endif
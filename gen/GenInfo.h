@@ -0,0 +1,132 @@
+#ifndef GENINFO_H
+#define GENINFO_H
+
+// Cross-section bookkeeping that survives hadd. hSigmaGen is a plain histogram
+// and gets summed over jobs, so every generation thread also writes one row of
+// the GenInfo tree; hadd concatenates rows, and readers combine them with
+// CrossSectionSum into the weighted mean over all threads of all jobs.
+//
+// Tree "GenInfo", one entry per generation thread:
+//   sigmaGen, sigmaErr   double    Pythia cross-section estimate and error [mb]
+//   nAccepted, nTried    Long64_t  accepted and tried events
+//   sumW, sumW2          double    sum of event weights and of their squares
+//   seed, jobIndex, thread  int    where the row comes from
+
+#include <cmath>
+#include <vector>
+#include <TDirectory.h>
+#include <TTree.h>
+
+static const char *const kGenInfoTreeName = "GenInfo";
+
+struct GenInfoRow
+{
+    double sigmaGen = 0.0;
+    double sigmaErr = 0.0;
+    Long64_t nAccepted = 0;
+    Long64_t nTried = 0;
+    double sumW = 0.0;
+    double sumW2 = 0.0;
+    int seed = 0;
+    int jobIndex = 0;
+    int thread = 0;
+};
+
+// Additive form of the estimates of independent runs: sigma is the mean
+// weighted by accepted events, its error follows from the per-run errors.
+struct CrossSectionSum
+{
+    double sigmaN = 0.0; // sum of sigmaGen * nAccepted
+    double errN2 = 0.0;  // sum of (sigmaErr * nAccepted)^2
+    Long64_t nAccepted = 0;
+    Long64_t nTried = 0;
+    double sumW = 0.0;
+    double sumW2 = 0.0;
+
+    void add(double sigmaGen, double sigmaErr, Long64_t accepted, Long64_t tried)
+    {
+        sigmaN += sigmaGen * accepted;
+        errN2 += (sigmaErr * accepted) * (sigmaErr * accepted);
+        nAccepted += accepted;
+        nTried += tried;
+    }
+
+    void add(const GenInfoRow &row)
+    {
+        add(row.sigmaGen, row.sigmaErr, row.nAccepted, row.nTried);
+        sumW += row.sumW;
+        sumW2 += row.sumW2;
+    }
+
+    void add(const CrossSectionSum &other)
+    {
+        sigmaN += other.sigmaN;
+        errN2 += other.errN2;
+        nAccepted += other.nAccepted;
+        nTried += other.nTried;
+        sumW += other.sumW;
+        sumW2 += other.sumW2;
+    }
+
+    double sigma() const { return nAccepted > 0 ? sigmaN / nAccepted : 0.0; }
+    double sigmaErr() const { return nAccepted > 0 ? std::sqrt(errN2) / nAccepted : 0.0; }
+};
+
+inline void writeGenInfo(TDirectory *dir, const std::vector<GenInfoRow> &rows)
+{
+    GenInfoRow row;
+    dir->cd();
+    TTree tree(kGenInfoTreeName, "Cross section of every generation thread");
+    tree.Branch("sigmaGen", &row.sigmaGen, "sigmaGen/D");
+    tree.Branch("sigmaErr", &row.sigmaErr, "sigmaErr/D");
+    tree.Branch("nAccepted", &row.nAccepted, "nAccepted/L");
+    tree.Branch("nTried", &row.nTried, "nTried/L");
+    tree.Branch("sumW", &row.sumW, "sumW/D");
+    tree.Branch("sumW2", &row.sumW2, "sumW2/D");
+    tree.Branch("seed", &row.seed, "seed/I");
+    tree.Branch("jobIndex", &row.jobIndex, "jobIndex/I");
+    tree.Branch("thread", &row.thread, "thread/I");
+    for (const auto &entry : rows)
+    {
+        row = entry;
+        tree.Fill();
+    }
+    tree.Write();
+    tree.SetDirectory(0);
+}
+
+// Appends the GenInfo rows of dir to rows; false if dir has no GenInfo tree.
+inline bool readGenInfoRows(TDirectory *dir, std::vector<GenInfoRow> &rows)
+{
+    // Owned by dir, like every tree read from a file
+    TTree *tree = dir->Get<TTree>(kGenInfoTreeName);
+    if (!tree) return false;
+    GenInfoRow row;
+    tree->SetBranchAddress("sigmaGen", &row.sigmaGen);
+    tree->SetBranchAddress("sigmaErr", &row.sigmaErr);
+    tree->SetBranchAddress("nAccepted", &row.nAccepted);
+    tree->SetBranchAddress("nTried", &row.nTried);
+    tree->SetBranchAddress("sumW", &row.sumW);
+    tree->SetBranchAddress("sumW2", &row.sumW2);
+    tree->SetBranchAddress("seed", &row.seed);
+    tree->SetBranchAddress("jobIndex", &row.jobIndex);
+    tree->SetBranchAddress("thread", &row.thread);
+    for (Long64_t i = 0; i < tree->GetEntries(); i++)
+    {
+        tree->GetEntry(i);
+        rows.push_back(row);
+    }
+    tree->ResetBranchAddresses();
+    return true;
+}
+
+// Adds all GenInfo rows of dir to sum; false if dir has no GenInfo tree.
+inline bool readGenInfo(TDirectory *dir, CrossSectionSum &sum)
+{
+    std::vector<GenInfoRow> rows;
+    if (!readGenInfoRows(dir, rows)) return false;
+    for (const auto &row : rows) sum.add(row);
+    return true;
+}
+
+#endif
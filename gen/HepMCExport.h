@@ -0,0 +1,163 @@
+#ifndef HEPMCEXPORT_H
+#define HEPMCEXPORT_H
+
+// HepMC3 export of the generated events (--hepmc FILE), for the detector
+// simulation chain, from the same run that fills our histograms. The format
+// follows the file name: .hepmc (ASCII), .hepmc.gz (compressed ASCII) or .root
+// (ROOT tree of HepMC3). Built only with make WITH_HEPMC3=1.
+//
+// Each generation thread converts its event (that needs the Pythia instance)
+// and hands it over through its own bounded single-producer ring; one writer
+// thread serialises, compresses and writes, so pythia.next() never waits on
+// disk. A full ring means the writer cannot keep up; the thread then backs off
+// until a slot frees, counted in waits(). The owner enables ROOT thread safety
+// before constructing an exporter, as the writer thread may do ROOT I/O (.root
+// output) while the job fills its histograms. Events are numbered in file order,
+// which mixes the threads. As for stored tracks, a job resumed from a
+// checkpoint starts a new file with the events generated since.
+
+class HepMCExporter;
+
+#ifdef WITH_HEPMC3
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <HepMC3/GenEvent.h>
+#include <HepMC3/Writer.h>
+#include <HepMC3/WriterAscii.h>
+#include <HepMC3/WriterGZ.h>
+#include <HepMC3/WriterRootTree.h>
+#include <Pythia8/Pythia.h>
+#include <Pythia8Plugins/HepMC3.h>
+
+// Bounded lock-free ring between one producer and one consumer thread.
+template <class T>
+class SpscRing
+{
+public:
+    explicit SpscRing(size_t capacity) : fSlots(capacity + 1) {}
+
+    bool push(T value)
+    {
+        const size_t tail = fTail.load(std::memory_order_relaxed);
+        const size_t next = (tail + 1) % fSlots.size();
+        if (next == fHead.load(std::memory_order_acquire)) return false;
+        fSlots[tail] = value;
+        fTail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &value)
+    {
+        const size_t head = fHead.load(std::memory_order_relaxed);
+        if (head == fTail.load(std::memory_order_acquire)) return false;
+        value = fSlots[head];
+        fHead.store((head + 1) % fSlots.size(), std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::vector<T> fSlots;
+    alignas(64) std::atomic<size_t> fHead{0};
+    alignas(64) std::atomic<size_t> fTail{0};
+};
+
+class HepMCExporter
+{
+public:
+    // nProducers generation threads, each with a ring of capacity events
+    HepMCExporter(const std::string &path, int nProducers, size_t capacity = 256) : fWriter(openWriter(path))
+    {
+        for (int i = 0; i < nProducers; i++)
+        {
+            fQueues.emplace_back(new SpscRing<HepMC3::GenEvent *>(capacity));
+            fConverters.emplace_back(new HepMC3::Pythia8ToHepMC3());
+        }
+        if (!failed()) fThread = std::thread(&HepMCExporter::run, this);
+    }
+
+    ~HepMCExporter() { finish(); }
+
+    bool failed() const { return !fWriter || fWriter->failed(); }
+
+    // Converts the current event of pythia and queues it; thread iThread only.
+    void push(int iThread, Pythia8::Pythia &pythia)
+    {
+        HepMC3::GenEvent *event = new HepMC3::GenEvent(HepMC3::Units::GEV, HepMC3::Units::MM);
+        fConverters[iThread]->fill_next_event(pythia, event);
+        while (!fQueues[iThread]->push(event))
+        {
+            fWaits.fetch_add(1, std::memory_order_relaxed);
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    // Writes what is still queued and closes the file; after the producers are done.
+    void finish()
+    {
+        if (fDone.exchange(true, std::memory_order_acq_rel)) return;
+        if (fThread.joinable()) fThread.join();
+        if (fWriter) fWriter->close();
+    }
+
+    long written() const { return fWritten; }
+    long waits() const { return fWaits.load(std::memory_order_relaxed); }
+
+private:
+    static std::unique_ptr<HepMC3::Writer> openWriter(const std::string &path)
+    {
+        auto endsWith = [&path](const std::string &suffix) {
+            return path.size() >= suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+        };
+        if (endsWith(".root")) return std::unique_ptr<HepMC3::Writer>(new HepMC3::WriterRootTree(path));
+        if (endsWith(".gz")) return std::unique_ptr<HepMC3::Writer>(new HepMC3::WriterGZ<HepMC3::WriterAscii>(path));
+        return std::unique_ptr<HepMC3::Writer>(new HepMC3::WriterAscii(path));
+    }
+
+    // Rings emptied; false if there was nothing to write
+    bool drain()
+    {
+        bool any = false;
+        HepMC3::GenEvent *event = nullptr;
+        for (auto &queue : fQueues)
+        {
+            while (queue->pop(event))
+            {
+                event->set_event_number(fWritten++);
+                fWriter->write_event(*event);
+                delete event;
+                any = true;
+            }
+        }
+        return any;
+    }
+
+    void run()
+    {
+        while (true)
+        {
+            // Read before draining: once set, every event is already queued
+            const bool done = fDone.load(std::memory_order_acquire);
+            if (drain()) continue;
+            if (done) break;
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    }
+
+    std::unique_ptr<HepMC3::Writer> fWriter;
+    std::vector<std::unique_ptr<SpscRing<HepMC3::GenEvent *>>> fQueues;
+    std::vector<std::unique_ptr<HepMC3::Pythia8ToHepMC3>> fConverters; // one per thread
+    std::atomic<bool> fDone{false};
+    std::atomic<long> fWaits{0};
+    long fWritten = 0; // writer thread, read after finish()
+    std::thread fThread;
+};
+
+#endif // WITH_HEPMC3
+
+#endif
@@ -0,0 +1,315 @@
+#ifndef JETANALYSIS_H
+#define JETANALYSIS_H
+
+// Track/jet analysis shared by the generator (pythia.C) and anything that
+// re-runs the same histogramming on stored tracks. Modules only see the list
+// of selected charged tracks, so N analyses cost one track selection per event.
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <TDirectory.h>
+#include <TH1.h>
+#include <TString.h>
+
+#include "FastHist.h"
+#include "OutputPolicy.h"
+#include "fastjet/PseudoJet.hh"
+#include "fastjet/JetDefinition.hh"
+#include "fastjet/ClusterSequence.hh"
+
+// Charged-track acceptance applied before any module sees the event
+const double kTrackEtaMax = 0.9;
+const double kTrackPtMin = 0.15;
+// Jet acceptance for the jet spectra
+const double kJetEtaMax = 0.5;
+// Largest anti-kT radius accepted by --jet-radii and Analysis:jetRadii
+const double kJetRadiusMax = 2.0;
+// Jets above this multiple of PhaseSpace:pTHatMax are dropped as outliers
+const double kOutlierJetPtFactor = 3.0;
+
+// jetPtCut of the jet modules for a pT-hat range ending at pTHatMax; -1 (no
+// cut) when the range is open.
+inline double outlierJetPtCut(double pTHatMax)
+{
+    return pTHatMax > 0.0 ? kOutlierJetPtFactor * pTHatMax : -1.0;
+}
+
+// Clustering strategies selectable through Analysis:jetStrategy or --jet-strategy.
+static const std::vector<std::pair<std::string, fastjet::Strategy>> kJetStrategies = {
+    {"Best", fastjet::Best},
+    {"N2Tiled", fastjet::N2Tiled},
+    {"N2MinHeapTiled", fastjet::N2MinHeapTiled},
+    {"N2Plain", fastjet::N2Plain},
+    {"NlnN", fastjet::NlnN},
+};
+
+inline bool findJetStrategy(const std::string &name, fastjet::Strategy &strategy)
+{
+    for (const auto &entry : kJetStrategies)
+    {
+        if (entry.first != name) continue;
+        strategy = entry.second;
+        return true;
+    }
+    return false;
+}
+
+// Anti-kT clustering with a jet definition built once for the whole run, so the
+// event loop only pays for the ClusterSequence itself.
+struct JetFinder
+{
+    fastjet::JetDefinition jetDef;
+
+    explicit JetFinder(double radius, fastjet::Strategy strategy = fastjet::Best)
+        : jetDef(fastjet::antikt_algorithm, radius, fastjet::E_scheme, strategy) // default recombination scheme
+    {
+    }
+
+    // Calls f(jet) for every inclusive jet of particles. Walks the clustering
+    // history in place instead of copying (and pT-sorting) the jets, since we
+    // only histogram them.
+    template <class F>
+    void forEachJet(const std::vector<fastjet::PseudoJet> &particles, F &&f) const
+    {
+        fastjet::ClusterSequence cs(particles, jetDef);
+        const std::vector<fastjet::ClusterSequence::history_element> &history = cs.history();
+        const std::vector<fastjet::PseudoJet> &jets = cs.jets();
+        for (const auto &step : history)
+        {
+            if (step.parent2 != fastjet::ClusterSequence::BeamJet) continue;
+            f(jets[history[step.parent1].jetp_index]);
+        }
+    }
+};
+
+// "R04" for R=0.4, "R025" for R=0.25
+inline std::string radiusTag(double radius)
+{
+    const int tenths = int(std::lround(radius * 10.0));
+    if (std::fabs(radius * 10.0 - tenths) < 1e-6) return Form("R%02d", tenths);
+    return Form("R%03d", int(std::lround(radius * 100.0)));
+}
+
+// One analysis fed with the selected charged tracks of every accepted event.
+// Each generation thread owns its own copy; copies are merged before writing.
+// weight is the event weight, 1 unless the phase space is biased. Modules fill
+// FastHist1D accumulators and fold them into their histograms when written.
+// An event goes through cluster() (jet finding, if any) and then fill(), so the
+// generator can time the two apart; process() does both.
+class AnalysisModule
+{
+public:
+    virtual ~AnalysisModule() {}
+    virtual void cluster(const std::vector<fastjet::PseudoJet> &tracks) {}
+    virtual void fill(const std::vector<fastjet::PseudoJet> &tracks, double weight) = 0;
+    void process(const std::vector<fastjet::PseudoJet> &tracks, double weight)
+    {
+        cluster(tracks);
+        fill(tracks, weight);
+    }
+    virtual void merge(const AnalysisModule &other) = 0;
+    virtual void write(TDirectory *dir) const = 0;
+    // Adds the histograms previously written to dir (a checkpoint) to this copy.
+    virtual void restore(TDirectory *dir) = 0;
+    // Histogram name of this module with every fill folded in, or nullptr if it
+    // has none of that name (used by the convergence check, see Convergence.h)
+    virtual const TH1 *histogram(const std::string &name) { return nullptr; }
+
+    // Histograms are written as TH1F when set, see OutputPolicy.h
+    void setFloatStorage(bool floatStorage) { fFloatStorage = floatStorage; }
+
+protected:
+    bool fFloatStorage = false;
+};
+
+// Adds histogram name from dir to h, if present. The copy read from dir is ours
+// to delete since histograms are not attached to directories.
+inline void addStoredHistogram(TDirectory *dir, const char *name, TH1 *h)
+{
+    std::unique_ptr<TH1> stored(dir->Get<TH1>(name));
+    if (stored) h->Add(stored.get());
+}
+
+class TrackPtModule : public AnalysisModule
+{
+public:
+    TrackPtModule()
+        : fTrackPt(new TH1D("hTrackPt", "Charged track p_{T} (|#eta|<0.9); p_{T} [GeV/c]; Counts", 50, 0, 50)),
+          fFill(*fTrackPt)
+    {
+        fTrackPt->SetDirectory(0);
+    }
+
+    void fill(const std::vector<fastjet::PseudoJet> &tracks, double weight) override
+    {
+        for (const auto &track : tracks) fFill.fill(track.pt(), weight);
+    }
+
+    void merge(const AnalysisModule &other) override
+    {
+        const TrackPtModule &module = static_cast<const TrackPtModule &>(other);
+        fFill.add(module.fFill);
+        fTrackPt->Add(module.fTrackPt.get());
+    }
+
+    void write(TDirectory *dir) const override
+    {
+        fFill.flush(*fTrackPt);
+        writeHistogram(dir, *fTrackPt, fFloatStorage);
+    }
+
+    void restore(TDirectory *dir) override { addStoredHistogram(dir, fTrackPt->GetName(), fTrackPt.get()); }
+
+    const TH1 *histogram(const std::string &name) override
+    {
+        if (name != fTrackPt->GetName()) return nullptr;
+        fFill.flush(*fTrackPt);
+        return fTrackPt.get();
+    }
+
+private:
+    std::unique_ptr<TH1D> fTrackPt;
+    mutable FastHist1D fFill; // fills not yet in fTrackPt
+};
+
+// Anti-kT jet pT spectrum for one radius, written as hJetPt_R<XX>. Jets above
+// jetPtCut (outlierJetPtCut() of the bin) are dropped as outliers when the cut is > 0.
+class JetPtModule : public AnalysisModule
+{
+public:
+    JetPtModule(double radius, fastjet::Strategy strategy, double jetPtCut, double jetEtaMax = kJetEtaMax)
+        : fFinder(radius, strategy), fJetPtCut(jetPtCut), fJetEtaMax(jetEtaMax),
+          fJetPt(new TH1D(("hJetPt_" + radiusTag(radius)).c_str(),
+                          Form("Jet p_{T} (anti-k_{T} R=%.2g); p_{T} [GeV/c]; Counts", radius), 200, 0, 200)),
+          fFill(*fJetPt)
+    {
+        fJetPt->SetDirectory(0);
+    }
+
+    // Keeps the pT of the jets in acceptance for fill()
+    void cluster(const std::vector<fastjet::PseudoJet> &tracks) override
+    {
+        fJetPts.clear();
+        fFinder.forEachJet(tracks, [&](const fastjet::PseudoJet &jet) {
+            if (std::fabs(jet.eta()) >= fJetEtaMax) return;
+            if (fJetPtCut > 0.0 && jet.pt() > fJetPtCut) return; // Skip jets beyond configured hard scale
+            fJetPts.push_back(jet.pt());
+        });
+    }
+
+    void fill(const std::vector<fastjet::PseudoJet> &, double weight) override
+    {
+        for (double pt : fJetPts) fFill.fill(pt, weight);
+    }
+
+    void merge(const AnalysisModule &other) override
+    {
+        const JetPtModule &module = static_cast<const JetPtModule &>(other);
+        fFill.add(module.fFill);
+        fJetPt->Add(module.fJetPt.get());
+    }
+
+    void write(TDirectory *dir) const override
+    {
+        fFill.flush(*fJetPt);
+        writeHistogram(dir, *fJetPt, fFloatStorage);
+        // R=0.4 is also kept under the historical name used by the postprocessing
+        if (radiusTag(fFinder.jetDef.R()) == "R04") writeHistogram(dir, *fJetPt, fFloatStorage, "hJetPt");
+    }
+
+    void restore(TDirectory *dir) override { addStoredHistogram(dir, fJetPt->GetName(), fJetPt.get()); }
+
+    const TH1 *histogram(const std::string &name) override
+    {
+        // hJetPt is the historical name of R=0.4, as in write()
+        if (name != fJetPt->GetName() && !(name == "hJetPt" && radiusTag(fFinder.jetDef.R()) == "R04")) return nullptr;
+        fFill.flush(*fJetPt);
+        return fJetPt.get();
+    }
+
+private:
+    JetFinder fFinder;
+    double fJetPtCut;
+    double fJetEtaMax;
+    std::unique_ptr<TH1D> fJetPt;
+    mutable FastHist1D fFill; // fills not yet in fJetPt
+    std::vector<double> fJetPts; // jets of the current event, from cluster()
+};
+
+// Parses a comma separated list such as "0.2,0.4" (used for --jet-radii);
+// throws std::invalid_argument on an entry that is not a number.
+inline std::vector<double> parseRadii(const std::string &list)
+{
+    std::vector<double> radii;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        if (item.empty()) continue;
+        size_t used = 0;
+        try
+        {
+            radii.push_back(std::stod(item, &used));
+        }
+        catch (const std::logic_error &) // invalid_argument or out_of_range
+        {
+            used = 0;
+        }
+        if (used != item.size()) throw std::invalid_argument("Invalid jet radius: " + item);
+    }
+    return radii;
+}
+
+// Sorted radii in (0, kJetRadiusMax], one per histogram name: radii with the
+// same radiusTag() would write the same hJetPt_R* key. Throws
+// std::invalid_argument on an empty list or a radius out of range.
+inline std::vector<double> checkRadii(std::vector<double> radii)
+{
+    if (radii.empty()) throw std::invalid_argument("No jet radius given");
+    std::sort(radii.begin(), radii.end());
+    for (double radius : radii)
+    {
+        if (!(radius > 0.0 && radius <= kJetRadiusMax))
+            throw std::invalid_argument(Form("Jet radius %g outside (0, %g]", radius, kJetRadiusMax));
+    }
+    radii.erase(std::unique(radii.begin(), radii.end(),
+                            [](double a, double b) { return radiusTag(a) == radiusTag(b); }),
+                radii.end());
+    return radii;
+}
+
+// Builds the module list from a comma separated module selection ("trackPt",
+// "jetPt") and the jet radii; jetPt expands into one module per distinct
+// radius (checkRadii).
+inline std::vector<std::unique_ptr<AnalysisModule>> makeAnalysisModules(
+    const std::string &moduleList, const std::vector<double> &radii, fastjet::Strategy strategy, double jetPtCut,
+    double jetEtaMax = kJetEtaMax)
+{
+    std::vector<std::unique_ptr<AnalysisModule>> modules;
+    std::stringstream stream(moduleList);
+    std::string name;
+    while (std::getline(stream, name, ','))
+    {
+        if (name == "trackPt")
+        {
+            modules.emplace_back(new TrackPtModule());
+        }
+        else if (name == "jetPt")
+        {
+            for (double radius : checkRadii(radii)) modules.emplace_back(new JetPtModule(radius, strategy, jetPtCut, jetEtaMax));
+        }
+        else if (!name.empty())
+        {
+            throw std::invalid_argument("Unknown analysis module: " + name);
+        }
+    }
+    return modules;
+}
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef OUTPUTPOLICY_H
+#define OUTPUTPOLICY_H
+
+// How job outputs are stored: compression of the file, optional float
+// storage of the analysis histograms, and a summary of what was written.
+//
+// Compression is ROOT's algorithm * 100 + level, or a name with an optional
+// level: "lz4" (404, fast to merge), "zstd" (505, small for archiving),
+// "zlib" (101, ROOT's default) or "lzma" (208), e.g. "zstd:7".
+//
+// Float storage halves the histograms on disk at ~7 significant digits, which
+// is below the statistical precision of any bin we fill. Empty bins cost next
+// to nothing once compressed, so they are not dropped: every job keeps the
+// same binning and the outputs still merge with hadd.
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <TDirectory.h>
+#include <TFile.h>
+#include <TH1.h>
+#include <TKey.h>
+
+static const int kDefaultCompression = 101;
+
+// Compression setting for name, or -1 if it is not one.
+inline int parseCompression(const std::string &name)
+{
+    const size_t colon = name.find(':');
+    const std::string algorithm = name.substr(0, colon);
+    static const std::pair<const char *, int> kAlgorithms[] = {{"zlib", 101}, {"lzma", 208}, {"lz4", 404}, {"zstd", 505}};
+    for (const auto &entry : kAlgorithms)
+    {
+        if (algorithm != entry.first) continue;
+        if (colon == std::string::npos) return entry.second;
+        char *end = nullptr;
+        const long level = std::strtol(name.c_str() + colon + 1, &end, 10);
+        if (*end || level < 1 || level > 9) return -1;
+        return entry.second / 100 * 100 + level;
+    }
+    // Plain ROOT setting such as 404
+    char *end = nullptr;
+    const long setting = std::strtol(name.c_str(), &end, 10);
+    if (name.empty() || *end || setting < 0 || setting > 509) return -1;
+    return int(setting);
+}
+
+// Single-precision copy of h with its errors and statistics, for writing.
+inline TH1F *floatCopy(const TH1D &h)
+{
+    const TAxis *axis = h.GetXaxis();
+    TH1F *copy = axis->GetXbins()->GetSize() > 0
+                     ? new TH1F(h.GetName(), h.GetTitle(), h.GetNbinsX(), axis->GetXbins()->GetArray())
+                     : new TH1F(h.GetName(), h.GetTitle(), h.GetNbinsX(), axis->GetXmin(), axis->GetXmax());
+    copy->SetDirectory(0);
+    copy->GetXaxis()->SetTitle(axis->GetTitle());
+    copy->GetYaxis()->SetTitle(h.GetYaxis()->GetTitle());
+    if (h.GetSumw2N() > 0) copy->Sumw2();
+    for (int bin = 0; bin <= h.GetNbinsX() + 1; bin++)
+    {
+        copy->SetBinContent(bin, h.GetBinContent(bin));
+        if (h.GetSumw2N() > 0) copy->SetBinError(bin, h.GetBinError(bin));
+    }
+    double stats[4] = {};
+    h.GetStats(stats);
+    copy->PutStats(stats);
+    copy->SetEntries(h.GetEntries());
+    return copy;
+}
+
+// Writes h to dir as name (its own name by default), as TH1F if asked to.
+inline void writeHistogram(TDirectory *dir, const TH1D &h, bool floatStorage, const char *name = nullptr)
+{
+    if (!floatStorage)
+    {
+        dir->WriteTObject(&h, name);
+        return;
+    }
+    std::unique_ptr<TH1F> copy(floatCopy(h));
+    dir->WriteTObject(copy.get(), name);
+}
+
+// Adds the key sizes below dir to sizes, as (path, compressed bytes).
+// TTree keys only hold the tree header, its baskets are not counted.
+inline void collectKeySizes(TDirectory *dir, const std::string &prefix, std::vector<std::pair<std::string, long long>> &sizes)
+{
+    for (TObject *obj : *dir->GetListOfKeys())
+    {
+        TKey *key = static_cast<TKey *>(obj);
+        const std::string path = prefix + key->GetName();
+        if (std::string(key->GetClassName()).compare(0, 10, "TDirectory") == 0)
+            collectKeySizes(dir->GetDirectory(key->GetName()), path + "/", sizes);
+        else
+            sizes.emplace_back(path, key->GetNbytes());
+    }
+}
+
+// Prints the bytes written to file and its largest objects; call after the
+// last write and before Close().
+inline void printOutputSummary(TFile &file, int nLargest = 5)
+{
+    file.Flush();
+    std::vector<std::pair<std::string, long long>> sizes;
+    collectKeySizes(&file, "", sizes);
+    std::sort(sizes.begin(), sizes.end(),
+              [](const std::pair<std::string, long long> &a, const std::pair<std::string, long long> &b) { return a.second > b.second; });
+    std::cout << "Output: " << file.GetName() << ", " << file.GetSize() / 1024.0 << " kB (compression "
+              << file.GetCompressionSettings() << ", " << sizes.size() << " objects)" << std::endl;
+    for (int i = 0; i < nLargest && i < int(sizes.size()); i++)
+        std::cout << "  " << sizes[i].first << ": " << sizes[i].second / 1024.0 << " kB" << std::endl;
+}
+
+#endif
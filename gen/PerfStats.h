@@ -0,0 +1,160 @@
+#ifndef PERFSTATS_H
+#define PERFSTATS_H
+
+// Per-phase timing of a generation job, written next to the physics histograms
+// so merged outputs carry the cost of every pT-hat bin.
+//
+// hPerf (additive, so hadd of many jobs gives totals; divide by the "jobs" bin
+// for per-job means):
+//   t_<phase>   thread-seconds spent in the phase
+//   events      generated events
+//   wall        job wall time [s]
+//   threads     generation threads, summed over the jobs
+//   peakRSS     peak resident memory of the job's process [MB], once per job
+//   jobs        jobs written into the directory: 1, or those of a bundle
+//
+// PerfTree, one entry per written directory (hadd concatenates them, so the
+// spread over jobs stays visible, e.g. the largest peakRSS for request_memory):
+//   the same quantities plus eventsPerSecond = events / wall; threads and
+//   peakRSS are those of one job.
+//
+// --perf-json writes the PerfTree row as a flat JSON object as well, for tools
+// without ROOT (run_PYTHIA.py reads it from its calibration runs).
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <TDirectory.h>
+#include <TH1.h>
+#include <TTree.h>
+
+enum PerfPhase
+{
+    kPerfInit,       // Pythia construction, init() and histogram booking
+    kPerfGenerate,   // pythia.next()
+    kPerfSelect,     // charged-track selection
+    kPerfCluster,    // analysis modules: jet clustering
+    kPerfFill,       // analysis modules: histogram filling
+    kPerfStore,      // TrackEvents collection and filling
+    kPerfExport,     // HepMC3 conversion and queueing
+    kPerfCheckpoint, // checkpoint writing
+    kPerfWrite,      // final output writing
+    kNPerfPhases
+};
+
+static const char *const kPerfPhaseNames[kNPerfPhases] = {"init", "generate", "select", "cluster", "fill", "store", "export", "checkpoint", "write"};
+
+struct PerfCounters
+{
+    double seconds[kNPerfPhases] = {};
+    long events = 0;
+
+    void add(const PerfCounters &other)
+    {
+        for (int i = 0; i < kNPerfPhases; i++) seconds[i] += other.seconds[i];
+        events += other.events;
+    }
+};
+
+// Charges the time since the previous call (or construction) to a phase, so a
+// sequence of phases costs one clock read per boundary. Returns the seconds charged.
+class PerfLap
+{
+public:
+    PerfLap() : fLast(std::chrono::steady_clock::now()) {}
+
+    double charge(PerfCounters &counters, PerfPhase phase)
+    {
+        const auto now = std::chrono::steady_clock::now();
+        const double seconds = std::chrono::duration<double>(now - fLast).count();
+        counters.seconds[phase] += seconds;
+        fLast = now;
+        return seconds;
+    }
+
+private:
+    std::chrono::steady_clock::time_point fLast;
+};
+
+// Peak resident set size of this process in MB (ru_maxrss is in kB on Linux).
+inline double peakRSSMB()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0.0;
+    return usage.ru_maxrss / 1024.0;
+}
+
+// Current resident set size of this process in MB, 0 where /proc is missing.
+inline double currentRSSMB()
+{
+    std::ifstream statm("/proc/self/statm");
+    long pages = 0, residentPages = 0;
+    if (!(statm >> pages >> residentPages)) return 0.0;
+    return residentPages * (sysconf(_SC_PAGESIZE) / 1024.0) / 1024.0;
+}
+
+// nJobs jobs of nThreads threads each were added into counters and wallSeconds.
+inline void writePerf(TDirectory *dir, const PerfCounters &counters, double wallSeconds, int nThreads, int nJobs = 1)
+{
+    double rssMB = peakRSSMB();
+
+    TH1D hPerf("hPerf", "Job performance; ; value", kNPerfPhases + 5, 0, kNPerfPhases + 5);
+    hPerf.SetDirectory(0);
+    int bin = 1;
+    for (int i = 0; i < kNPerfPhases; i++, bin++)
+    {
+        hPerf.GetXaxis()->SetBinLabel(bin, (std::string("t_") + kPerfPhaseNames[i]).c_str());
+        hPerf.SetBinContent(bin, counters.seconds[i]);
+    }
+    const std::pair<const char *, double> totals[] = {
+        {"events", double(counters.events)}, {"wall", wallSeconds}, {"threads", double(nThreads) * nJobs}, {"peakRSS", rssMB * nJobs}, {"jobs", double(nJobs)}};
+    for (const auto &entry : totals)
+    {
+        hPerf.GetXaxis()->SetBinLabel(bin, entry.first);
+        hPerf.SetBinContent(bin++, entry.second);
+    }
+    dir->WriteTObject(&hPerf);
+
+    double phaseSeconds[kNPerfPhases];
+    double events = counters.events;
+    double eventsPerSecond = wallSeconds > 0.0 ? counters.events / wallSeconds : 0.0;
+    int threads = nThreads;
+    int jobs = nJobs;
+    dir->cd();
+    TTree tree("PerfTree", "Performance of each generation job");
+    for (int i = 0; i < kNPerfPhases; i++)
+    {
+        phaseSeconds[i] = counters.seconds[i];
+        const std::string name = std::string("t_") + kPerfPhaseNames[i];
+        tree.Branch(name.c_str(), &phaseSeconds[i], (name + "/D").c_str());
+    }
+    tree.Branch("events", &events, "events/D");
+    tree.Branch("wall", &wallSeconds, "wall/D");
+    tree.Branch("eventsPerSecond", &eventsPerSecond, "eventsPerSecond/D");
+    tree.Branch("threads", &threads, "threads/I");
+    tree.Branch("peakRSS", &rssMB, "peakRSS/D");
+    tree.Branch("jobs", &jobs, "jobs/I");
+    tree.Fill();
+    tree.Write();
+    tree.SetDirectory(0);
+
+    std::cout << "Performance: " << counters.events << " events in " << wallSeconds << " s ("
+              << eventsPerSecond << " events/s), peak RSS " << rssMB << " MB" << std::endl;
+}
+
+inline bool writePerfJSON(const std::string &path, const PerfCounters &counters, double wallSeconds, int nThreads)
+{
+    std::ofstream out(path);
+    out << "{";
+    for (int i = 0; i < kNPerfPhases; i++) out << "\"t_" << kPerfPhaseNames[i] << "\": " << counters.seconds[i] << ", ";
+    out << "\"events\": " << counters.events << ", \"wall\": " << wallSeconds
+        << ", \"eventsPerSecond\": " << (wallSeconds > 0.0 ? counters.events / wallSeconds : 0.0)
+        << ", \"threads\": " << nThreads << ", \"peakRSS\": " << peakRSSMB() << "}" << std::endl;
+    return bool(out);
+}
+
+#endif
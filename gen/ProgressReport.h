@@ -0,0 +1,168 @@
+#ifndef PROGRESSREPORT_H
+#define PROGRESSREPORT_H
+
+// Live progress of a running job, for spotting slow bins and stragglers before
+// the outputs land. Every --status-seconds a reporter thread replaces the
+// --status-file with one JSON object (written to a temporary and renamed, so a
+// reader never sees half a record):
+//   state            "running", then "done" once the events are generated
+//   config, output, jobIndex, workerJob, threads
+//   events, total    event loop iterations done (resumed ones included) and planned
+//   eventsPerSecond  over the last interval
+//   elapsed, eta     seconds since the job started and to its last event
+//   rssMB, peakRSSMB
+//   time             Unix time of the record
+// With --chirp the same record is also set as the PythiaStatus attribute of the
+// Condor job (condor_chirp set_job_attr_delayed, needs +WantIOProxy), so
+// condor_q sees it while the job runs. job_status.py summarises both.
+//
+// Threads only bump one relaxed atomic per event; all formatting and I/O is on
+// the reporter thread.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "PerfStats.h"
+
+class ProgressReporter
+{
+public:
+    ProgressReporter(const std::string &statusFile, double intervalSeconds, bool chirp, const std::string &config,
+                     const std::string &output, int jobIndex, int workerJob, int nThreads)
+        : fStatusFile(statusFile), fInterval(intervalSeconds > 0.0 ? intervalSeconds : 60.0), fChirp(chirp),
+          fConfig(config), fOutput(output), fJobIndex(jobIndex), fWorkerJob(workerJob), fNThreads(nThreads),
+          fStart(std::chrono::steady_clock::now()), fLastTime(fStart)
+    {
+        writeRecord("running");
+        fThread = std::thread(&ProgressReporter::run, this);
+    }
+
+    ~ProgressReporter() { finish(); }
+
+    // Called by each thread once it knows its share; resumed events count as done
+    void addPlanned(long total, long done)
+    {
+        fTotal.fetch_add(total, std::memory_order_relaxed);
+        fResumed.fetch_add(done, std::memory_order_relaxed);
+    }
+
+    void addEvent() { fGenerated.fetch_add(1, std::memory_order_relaxed); }
+
+    // Stops the reporter and writes the final record; later calls do nothing.
+    void finish()
+    {
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            if (fStop) return;
+            fStop = true;
+        }
+        fWake.notify_one();
+        fThread.join();
+        writeRecord("done");
+    }
+
+private:
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(fMutex);
+        while (!fWake.wait_for(lock, std::chrono::duration<double>(fInterval), [this] { return fStop; }))
+        {
+            lock.unlock();
+            writeRecord("running");
+            lock.lock();
+        }
+    }
+
+    static std::string quoted(const std::string &text)
+    {
+        std::string out = "\"";
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\') out += '\\';
+            out += c;
+        }
+        return out + "\"";
+    }
+
+    void writeRecord(const char *state)
+    {
+        const auto now = std::chrono::steady_clock::now();
+        const long generated = fGenerated.load(std::memory_order_relaxed);
+        const long events = generated + fResumed.load(std::memory_order_relaxed);
+        const long total = fTotal.load(std::memory_order_relaxed);
+        const double elapsed = std::chrono::duration<double>(now - fStart).count();
+        const double interval = std::chrono::duration<double>(now - fLastTime).count();
+        const double rate = interval > 0.0 ? (generated - fLastGenerated) / interval : 0.0;
+        fLastTime = now;
+        fLastGenerated = generated;
+        // Unknown until a rate has been measured
+        const double eta = total > events ? (rate > 0.0 ? (total - events) / rate : -1.0) : 0.0;
+
+        std::ostringstream record;
+        record << "{\"state\": " << quoted(state) << ", \"config\": " << quoted(fConfig)
+               << ", \"output\": " << quoted(fOutput) << ", \"jobIndex\": " << fJobIndex
+               << ", \"workerJob\": " << fWorkerJob << ", \"threads\": " << fNThreads << ", \"events\": " << events
+               << ", \"total\": " << total << ", \"eventsPerSecond\": " << rate << ", \"elapsed\": " << elapsed
+               << ", \"eta\": " << eta << ", \"rssMB\": " << currentRSSMB() << ", \"peakRSSMB\": " << peakRSSMB()
+               << ", \"time\": " << long(std::time(nullptr)) << "}";
+
+        const std::string tmpFile = fStatusFile + ".tmp";
+        {
+            std::ofstream out(tmpFile);
+            out << record.str() << std::endl;
+        }
+        if (std::rename(tmpFile.c_str(), fStatusFile.c_str()) != 0)
+            std::cerr << "Failed to write status file " << fStatusFile << std::endl;
+        if (fChirp) chirp(record.str());
+    }
+
+    // The attribute is a ClassAd string, so the record is quoted once more
+    void chirp(const std::string &record)
+    {
+        std::string value = "\"";
+        for (char c : record)
+        {
+            if (c == '"' || c == '\\') value += '\\';
+            if (c == '\'') value += "'\\'";
+            value += c;
+        }
+        value += "\"";
+        const std::string command = "condor_chirp set_job_attr_delayed PythiaStatus '" + value + "' >/dev/null 2>&1";
+        if (std::system(command.c_str()) != 0)
+        {
+            std::cerr << "condor_chirp failed; status is only written to " << fStatusFile << std::endl;
+            fChirp = false;
+        }
+    }
+
+    std::string fStatusFile;
+    double fInterval;
+    bool fChirp;
+    std::string fConfig;
+    std::string fOutput;
+    int fJobIndex;
+    int fWorkerJob;
+    int fNThreads;
+    std::atomic<long> fGenerated{0}; // by this run
+    std::atomic<long> fResumed{0};   // restored from checkpoints
+    std::atomic<long> fTotal{0};
+    std::chrono::steady_clock::time_point fStart;
+    std::chrono::steady_clock::time_point fLastTime; // of the previous record, reporter thread only
+    long fLastGenerated = 0;
+    std::mutex fMutex;
+    std::condition_variable fWake;
+    bool fStop = false;
+    std::thread fThread;
+};
+
+#endif
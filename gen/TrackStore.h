@@ -0,0 +1,145 @@
+#ifndef TRACKSTORE_H
+#define TRACKSTORE_H
+
+// Compact per-event record of the final-state charged tracks, so new cuts or
+// jet definitions can be tried on stored events instead of regenerating them.
+//
+// Tree "TrackEvents", one entry per accepted event (also events without tracks,
+// so the entry count normalises like hnevent):
+//   weight       double         event weight (1 for unweighted generation)
+//   pTHat        float          pT-hat of the hard process [GeV/c]
+//   px, py, pz   vector<float>  track momentum [GeV/c]
+//   m            vector<float>  track mass [GeV/c^2], E is rebuilt from it
+// Its user info holds TParameter<double> "pTHatMax", PhaseSpace:pTHatMax of the
+// run, so a reanalysis applies the generator's outlier-jet cut.
+
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+#include <vector>
+#include <TDirectory.h>
+#include <TList.h>
+#include <TParameter.h>
+#include <TTree.h>
+
+static const char *const kTrackTreeName = "TrackEvents";
+static const char *const kTrackPTHatMaxName = "pTHatMax";
+
+struct TrackEventBuffer
+{
+    double weight = 1.0;
+    float pTHat = 0.0;
+    std::vector<float> px, py, pz, m;
+
+    void clear()
+    {
+        px.clear();
+        py.clear();
+        pz.clear();
+        m.clear();
+    }
+
+    void add(double pxIn, double pyIn, double pzIn, double mIn)
+    {
+        px.push_back(pxIn);
+        py.push_back(pyIn);
+        pz.push_back(pzIn);
+        m.push_back(mIn);
+    }
+};
+
+// Owns the TrackEvents tree in the output file and lets every generation thread
+// append to it. Filling stops once the compressed size reaches maxBytes, so the
+// output stays inside the job's disk request; the first events are kept, which
+// is an unbiased subset of the run. TTree only counts baskets once they are
+// written, so the size includes the baskets still in memory at the compression
+// ratio of the written ones (1 before the first is written); the budget is then
+// exceeded by at most the estimate error of the last baskets, not by them.
+class TrackEventWriter
+{
+public:
+    TrackEventWriter(TDirectory *dir, long long maxBytes, int basketSize = 64000)
+        : fMaxBytes(maxBytes)
+    {
+        dir->cd();
+        fTree = new TTree(kTrackTreeName, "Selected charged tracks per event");
+        fTree->Branch("weight", &fEvent.weight, "weight/D");
+        fTree->Branch("pTHat", &fEvent.pTHat, "pTHat/F");
+        fTree->Branch("px", &fEvent.px, basketSize);
+        fTree->Branch("py", &fEvent.py, basketSize);
+        fTree->Branch("pz", &fEvent.pz, basketSize);
+        fTree->Branch("m", &fEvent.m, basketSize);
+    }
+
+    // Thread-safe. Returns false once the size budget is used up.
+    bool fill(const TrackEventBuffer &event)
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        if (fFull) return false;
+        fEvent.weight = event.weight;
+        fEvent.pTHat = event.pTHat;
+        fEvent.px = event.px;
+        fEvent.py = event.py;
+        fEvent.pz = event.pz;
+        fEvent.m = event.m;
+        fFilledBytes += fTree->Fill();
+        if (estimatedZipBytes() >= fMaxBytes)
+        {
+            fFull = true;
+            std::cout << "TrackEvents reached " << fMaxBytes / (1024 * 1024) << " MB after "
+                      << fTree->GetEntries() << " events, storing stops here" << std::endl;
+        }
+        return true;
+    }
+
+    // Stored with the tree; call before finish().
+    void setPTHatMax(double pTHatMax)
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        if (!fPTHatMax)
+        {
+            fPTHatMax = new TParameter<double>(kTrackPTHatMaxName, pTHatMax);
+            fTree->GetUserInfo()->Add(fPTHatMax);
+        }
+        fPTHatMax->SetVal(pTHatMax);
+    }
+
+    // Flushes the remaining baskets; call once all threads are done.
+    void finish()
+    {
+        fTree->Write("", TObject::kOverwrite);
+        std::cout << "TrackEvents: " << fTree->GetEntries() << " events, "
+                  << fTree->GetZipBytes() / 1024 << " kB compressed" << std::endl;
+    }
+
+private:
+    long long estimatedZipBytes() const
+    {
+        const long long written = fTree->GetTotBytes();
+        const long long pending = std::max(0LL, fFilledBytes - written);
+        const double ratio = written > 0 ? double(fTree->GetZipBytes()) / written : 1.0;
+        return fTree->GetZipBytes() + (long long)(pending * ratio);
+    }
+
+    std::mutex fMutex;
+    TTree *fTree = nullptr; // owned by the output directory
+    TParameter<double> *fPTHatMax = nullptr; // owned by fTree's user info
+    TrackEventBuffer fEvent;
+    long long fMaxBytes;
+    long long fFilledBytes = 0; // uncompressed, as returned by TTree::Fill()
+    bool fFull = false;
+};
+
+// pTHatMax stored with the TrackEvents of dir; false without the tree or it.
+inline bool readTrackPTHatMax(TDirectory *dir, double &pTHatMax)
+{
+    // Owned by dir, like every tree read from a file
+    TTree *tree = dir->Get<TTree>(kTrackTreeName);
+    if (!tree) return false;
+    TParameter<double> *parameter = dynamic_cast<TParameter<double> *>(tree->GetUserInfo()->FindObject(kTrackPTHatMaxName));
+    if (!parameter) return false;
+    pTHatMax = parameter->GetVal();
+    return true;
+}
+
+#endif
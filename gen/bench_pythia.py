@@ -0,0 +1,307 @@
+#!/usr/bin/env python3
+"""
+Generator throughput benchmark on a fixed reference configuration.
+
+`run` generates a low, mid and high pT-hat bin at 5.02 and 13.6 TeV with fixed
+seeds and event counts, one ./pythia process per point so each peak RSS is its
+own, and writes one JSON with the build it measured (compiler, flags, ROOT,
+FastJet and Pythia versions, git commit) and per point:
+
+  eventsPerSecond      events / job wall time, init included
+  loopEventsPerSecond  events / (generate + select + cluster + fill) seconds
+  clusteringSeconds    cluster phase: jet finding of all radii
+  clusteringMicrosPerEvent
+  fillSeconds          fill phase: histogram filling of all modules
+  peakRSS              MB
+
+`compare` prints two such files side by side and fails when the throughput of a
+point dropped by more than --tolerance. Points are only compared when their
+reference (bins, seeds, events) is the same.
+
+`verify` runs two binaries (e.g. the default and the optimised build) on the
+same points and seeds and fails unless every histogram and the GenInfo rows are
+bin-by-bin identical; the timing histograms are skipped. Needs PyROOT.
+
+    make bench                         # writes bench_<date>.json
+    ./bench_pythia.py compare old.json new.json
+    ./bench_pythia.py verify ./pythia ./pythia_opt
+"""
+
+from __future__ import annotations
+
+import argparse
+import json
+import os
+import platform
+import re
+import subprocess
+import sys
+import tempfile
+from datetime import datetime
+from pathlib import Path
+from typing import Dict, Iterable, List, Optional, Tuple
+
+# Bump when a point, seed, event count or metric changes, so old results are not compared
+REFERENCE_VERSION = 2
+REFERENCE_EVENTS = 1000
+REFERENCE_SEED = 20250101
+# (eCM [GeV], default config, pTHatMin, pTHatMax); -1 is no upper limit
+REFERENCE_POINTS = [
+    (5020, "default_pythia_config_pp_5020GeV.cmnd", 11.0, 21.0),
+    (5020, "default_pythia_config_pp_5020GeV.cmnd", 57.0, 84.0),
+    (5020, "default_pythia_config_pp_5020GeV.cmnd", 234.0, -1.0),
+    (13600, "default_pythia_config_13_6_TEV.cmnd", 11.0, 21.0),
+    (13600, "default_pythia_config_13_6_TEV.cmnd", 57.0, 84.0),
+    (13600, "default_pythia_config_13_6_TEV.cmnd", 234.0, -1.0),
+]
+
+GEN_DIR = Path(__file__).resolve().parent
+METRICS = ["eventsPerSecond", "loopEventsPerSecond", "clusteringMicrosPerEvent", "peakRSS"]
+# Wall-clock measurements, which differ between any two runs
+TIMING_OBJECTS = {"hPerf", "PerfTree", "hJetFindTime", "hJetFindTimeVsMult"}
+
+
+def parse_args(argv: Optional[Iterable[str]] = None) -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description="Benchmark ./pythia on the fixed reference points.")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    run = sub.add_parser("run", help="Run the reference points and write their JSON.")
+    run.add_argument("--output", required=True, help="JSON file to write.")
+    run.add_argument("--events", type=int, default=REFERENCE_EVENTS,
+                     help="Events per point; results are only comparable at the same count.")
+    run.add_argument("--threads", type=int, default=1, help="Generation threads per point.")
+    run.add_argument("--binary", default="./pythia", help="Generator binary, relative to gen/ (default ./pythia).")
+    run.add_argument("--cxx", default="g++", help="Compiler the binary was built with (recorded only).")
+    run.add_argument("--cxxflags", default="", help="Flags the binary was built with (recorded only).")
+    run.add_argument("--work-dir", help="Keep the configs, outputs and logs here instead of a temporary directory.")
+
+    compare = sub.add_parser("compare", help="Compare two benchmark JSON files.")
+    compare.add_argument("baseline")
+    compare.add_argument("candidate")
+    compare.add_argument("--tolerance", type=float, default=0.05,
+                         help="Allowed relative loss of eventsPerSecond before failing (default 0.05).")
+
+    verify = sub.add_parser("verify", help="Check that two binaries produce identical spectra.")
+    verify.add_argument("reference", help="Binary of the default build, e.g. ./pythia.")
+    verify.add_argument("candidate", help="Binary to check, e.g. ./pythia_opt.")
+    verify.add_argument("--events", type=int, default=200, help="Events per point (default 200).")
+    verify.add_argument("--threads", type=int, default=1, help="Generation threads per point.")
+    verify.add_argument("--work-dir", help="Keep the outputs and logs here instead of a temporary directory.")
+    return parser.parse_args(argv)
+
+
+def point_name(ecm: int, pthat_min: float, pthat_max: float) -> str:
+    upper = "infy" if pthat_max < 0 else f"{pthat_max:g}"
+    return f"pp{ecm}GeV_pthat_{pthat_min:g}_{upper}"
+
+
+def point_config(default_cmnd: Path, pthat_min: float, pthat_max: float, events: int) -> str:
+    text = default_cmnd.read_text(encoding="utf-8")
+    for key, value in (("PhaseSpace:pTHatMin", f"{pthat_min:g}"), ("PhaseSpace:pTHatMax", f"{pthat_max:g}"),
+                       ("Main:numberOfEvents", str(events))):
+        text, count = re.subn(rf"^(\s*{key}\s*=\s*)\S+", rf"\g<1>{value}", text, count=1, flags=re.MULTILINE)
+        if not count:
+            text += f"{key} = {value}\n"
+    return text
+
+
+def command_output(command: List[str]) -> str:
+    try:
+        return subprocess.run(command, capture_output=True, text=True, check=True).stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return ""
+
+
+def cpu_model() -> str:
+    try:
+        for line in Path("/proc/cpuinfo").read_text().splitlines():
+            if line.startswith("model name"):
+                return line.split(":", 1)[1].strip()
+    except OSError:
+        pass
+    return platform.processor()
+
+
+def build_info(args: argparse.Namespace) -> Dict[str, str]:
+    fastjet = os.environ.get("FASTJET", "")
+    compiler = command_output([args.cxx, "--version"])
+    return {
+        "cxx": compiler.splitlines()[0] if compiler else args.cxx,
+        "cxxflags": args.cxxflags,
+        "root": command_output(["root-config", "--version"]),
+        "fastjet": command_output([str(Path(fastjet) / "bin" / "fastjet-config"), "--version"]) if fastjet else "",
+        # alienv installs Pythia under .../pythia/<version>
+        "pythia": Path(os.environ.get("PYTHIA8", "")).name,
+        "git": command_output(["git", "-C", str(GEN_DIR), "rev-parse", "--short", "HEAD"]),
+        "gitDirty": bool(command_output(["git", "-C", str(GEN_DIR), "status", "--porcelain", "--untracked-files=no"])),
+    }
+
+
+def generate_point(binary: str, work_dir: Path, index: int, point, events: int, threads: int,
+                   tag: str = "") -> Tuple[str, int, Path, Path]:
+    """Runs binary on one reference point; returns its name, seed, output and perf JSON."""
+    ecm, default_name, pthat_min, pthat_max = point
+    name = point_name(ecm, pthat_min, pthat_max)
+    cmnd = work_dir / f"{name}.cmnd"
+    cmnd.write_text(point_config(GEN_DIR / "config" / default_name, pthat_min, pthat_max, events), encoding="utf-8")
+    output = work_dir / f"{name}{tag}.root"
+    perf_json = work_dir / f"{name}{tag}_perf.json"
+    seed = REFERENCE_SEED + index * 1000
+    print(f"{name}: {binary}, {events} events, seed {seed}", flush=True)
+    with (work_dir / f"{name}{tag}.log").open("w", encoding="utf-8") as log:
+        subprocess.run(
+            [binary, str(seed), str(output), str(cmnd), "--threads", str(threads), "--perf-json", str(perf_json)],
+            cwd=GEN_DIR, stdout=log, stderr=subprocess.STDOUT, check=True,
+        )
+    return name, seed, output, perf_json
+
+
+def run_point(binary: str, work_dir: Path, index: int, point, events: int, threads: int) -> Dict[str, float]:
+    ecm, _, pthat_min, pthat_max = point
+    name, seed, _, perf_json = generate_point(binary, work_dir, index, point, events, threads)
+    perf = json.loads(perf_json.read_text(encoding="utf-8"))
+    loop_seconds = perf["t_generate"] + perf["t_select"] + perf["t_cluster"] + perf["t_fill"]
+    n_events = max(perf["events"], 1)
+    return {
+        "name": name,
+        "eCM": ecm,
+        "pTHatMin": pthat_min,
+        "pTHatMax": pthat_max,
+        "seed": seed,
+        "events": perf["events"],
+        "threads": perf["threads"],
+        "wall": perf["wall"],
+        "initSeconds": perf["t_init"],
+        "generateSeconds": perf["t_generate"],
+        "clusteringSeconds": perf["t_cluster"],
+        "fillSeconds": perf["t_fill"],
+        "eventsPerSecond": perf["eventsPerSecond"],
+        # Thread-seconds, so scale back to the wall clock of the threads
+        "loopEventsPerSecond": perf["events"] * perf["threads"] / loop_seconds if loop_seconds > 0 else 0.0,
+        "clusteringMicrosPerEvent": 1e6 * perf["t_cluster"] / n_events,
+        "peakRSS": perf["peakRSS"],
+    }
+
+
+def run_benchmark(args: argparse.Namespace) -> int:
+    if not (GEN_DIR / args.binary).is_file():
+        print(f"{args.binary} not found; build it with make first", file=sys.stderr)
+        return 1
+    result = {
+        "reference": {"version": REFERENCE_VERSION, "events": args.events, "threads": args.threads},
+        "date": datetime.now().isoformat(timespec="seconds"),
+        "host": platform.node(),
+        "cpu": cpu_model(),
+        "binary": args.binary,
+        "build": build_info(args),
+        "points": [],
+    }
+    with tempfile.TemporaryDirectory(prefix="bench_pythia_") as temp_dir:
+        work_dir = Path(args.work_dir) if args.work_dir else Path(temp_dir)
+        work_dir.mkdir(parents=True, exist_ok=True)
+        for index, point in enumerate(REFERENCE_POINTS):
+            try:
+                result["points"].append(
+                    run_point(args.binary, work_dir.resolve(), index, point, args.events, args.threads))
+            except subprocess.CalledProcessError:
+                print(f"Point {point_name(point[0], point[2], point[3])} failed; see its log"
+                      + (f" in {work_dir}" if args.work_dir else " (rerun with --work-dir to keep it)"),
+                      file=sys.stderr)
+                return 1
+    Path(args.output).write_text(json.dumps(result, indent=2) + "\n", encoding="utf-8")
+    print(f"{'point':<28}" + "".join(f"{metric:>26}" for metric in METRICS))
+    for point in result["points"]:
+        print(f"{point['name']:<28}" + "".join(f"{point[metric]:>26.4g}" for metric in METRICS))
+    print(f"Wrote {args.output}")
+    return 0
+
+
+def compare_benchmarks(args: argparse.Namespace) -> int:
+    baseline = json.loads(Path(args.baseline).read_text(encoding="utf-8"))
+    candidate = json.loads(Path(args.candidate).read_text(encoding="utf-8"))
+    if baseline["reference"] != candidate["reference"]:
+        print(f"Different references: {baseline['reference']} vs {candidate['reference']}", file=sys.stderr)
+        return 1
+    for key in sorted(set(baseline["build"]) | set(candidate["build"])):
+        old, new = baseline["build"].get(key, ""), candidate["build"].get(key, "")
+        if old != new:
+            print(f"{key}: {old} -> {new}")
+
+    regressions = []
+    old_points = {point["name"]: point for point in baseline["points"]}
+    print(f"{'point':<28}" + "".join(f"{metric:>26}" for metric in METRICS))
+    for point in candidate["points"]:
+        old = old_points.get(point["name"])
+        if not old:
+            continue
+        ratios = [point[metric] / old[metric] if old[metric] else float("nan") for metric in METRICS]
+        print(f"{point['name']:<28}" + "".join(f"{ratio:>26.3f}" for ratio in ratios))
+        if ratios[0] < 1.0 - args.tolerance:
+            regressions.append(point["name"])
+    if regressions:
+        print(f"Throughput dropped by more than {args.tolerance:.0%}: {', '.join(regressions)}", file=sys.stderr)
+        return 1
+    return 0
+
+
+def read_objects(path: Path, ROOT) -> Dict[str, List[float]]:
+    """Every histogram (contents, errors, entries) and tree row of a job output, keyed by name."""
+    objects = {}
+    root_file = ROOT.TFile.Open(str(path))
+    for key in root_file.GetListOfKeys():
+        name = key.GetName()
+        if name in TIMING_OBJECTS or name in objects:
+            continue
+        obj = key.ReadObj()
+        if obj.InheritsFrom("TH1"):
+            n_cells = obj.GetNcells()
+            objects[name] = ([obj.GetBinContent(i) for i in range(n_cells)]
+                             + [obj.GetBinError(i) for i in range(n_cells)] + [obj.GetEntries()])
+        elif obj.InheritsFrom("TTree"):
+            values = []
+            leaves = [leaf.GetName() for leaf in obj.GetListOfLeaves()]
+            for entry in obj:
+                values.extend(float(getattr(entry, leaf)) for leaf in leaves)
+            objects[name] = values
+    root_file.Close()
+    return objects
+
+
+def verify_builds(args: argparse.Namespace) -> int:
+    import ROOT
+
+    for binary in (args.reference, args.candidate):
+        if not (GEN_DIR / binary).is_file():
+            print(f"{binary} not found; build it first", file=sys.stderr)
+            return 1
+    mismatches = []
+    with tempfile.TemporaryDirectory(prefix="verify_build_") as temp_dir:
+        work_dir = (Path(args.work_dir) if args.work_dir else Path(temp_dir)).resolve()
+        work_dir.mkdir(parents=True, exist_ok=True)
+        for index, point in enumerate(REFERENCE_POINTS):
+            name, _, reference, _ = generate_point(args.reference, work_dir, index, point, args.events, args.threads,
+                                                   "_reference")
+            _, _, candidate, _ = generate_point(args.candidate, work_dir, index, point, args.events, args.threads,
+                                                "_candidate")
+            expected, found = read_objects(reference, ROOT), read_objects(candidate, ROOT)
+            for obj in sorted(set(expected) | set(found)):
+                if expected.get(obj) != found.get(obj):
+                    mismatches.append(f"{name}/{obj}")
+    if mismatches:
+        print(f"{args.candidate} differs from {args.reference} in: {', '.join(mismatches)}", file=sys.stderr)
+        return 1
+    print(f"{args.candidate} reproduces {args.reference} bin by bin on {len(REFERENCE_POINTS)} points")
+    return 0
+
+
+def main(argv: Optional[Iterable[str]] = None) -> int:
+    args = parse_args(argv)
+    if args.command == "run":
+        return run_benchmark(args)
+    if args.command == "verify":
+        return verify_builds(args)
+    return compare_benchmarks(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
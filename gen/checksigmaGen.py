@@ -6,6 +6,12 @@ Given an input directory, the script searches recursively for *.out files,
 grabs the last `sigmaGen:` entry in each file, and writes a tab-delimited
 summary report. The directory component that contains "pthat" is used as the
 identifier so different pT̂-hat bins can be matched to their sigmaGen values.
+
+With --from-root the GenInfo trees written by gen/pythia.C are read from the
+*.root job outputs instead, or with --merged from the *_merged.root files only;
+a merged file repeats the rows of its jobs, so the two are never added up. Each
+bin then gets the mean weighted by accepted events and its error, without
+parsing any log.
 """
 
 from __future__ import annotations
@@ -34,6 +40,8 @@ class AggregatedSigmaRecord:
     pthat_label: str
     average_sigma_mb: float
     log_paths: List[Path]
+    sigma_err_mb: Optional[float] = None
+    n_accepted: Optional[int] = None
 
 
 def parse_args(argv: Optional[Iterable[str]] = None) -> argparse.Namespace:
@@ -59,6 +67,16 @@ def parse_args(argv: Optional[Iterable[str]] = None) -> argparse.Namespace:
         default="utf-8",
         help="Text encoding used when reading log files (default: utf-8).",
     )
+    parser.add_argument(
+        "--from-root",
+        action="store_true",
+        help="Read the GenInfo trees of the *.root files instead of the *.out logs (needs PyROOT).",
+    )
+    parser.add_argument(
+        "--merged",
+        action="store_true",
+        help="With --from-root, read the *_merged.root files instead of the job outputs.",
+    )
     return parser.parse_args(argv)
 
 
@@ -66,6 +84,10 @@ def find_pthat_label(path: Path) -> str:
     for part in reversed(path.parts[:-1]):  # Ignore the filename itself
         if "pthat" in part.lower():
             return part
+    # Merged files are named after their bin, e.g. pthat_5_11_merged.root
+    match = re.search(r"pthat_[0-9]+_(?:[0-9]+|infy)", path.stem.lower())
+    if match:
+        return match.group(0)
     return path.parent.name
 
 
@@ -161,13 +183,68 @@ def aggregate_sigma_records(records: List[SigmaRecord]) -> List[AggregatedSigmaR
     )
 
 
+def aggregate_root_files(root: Path, merged: bool = False) -> List[AggregatedSigmaRecord]:
+    import ROOT  # type: ignore[attr-defined]
+
+    # Per bin: [sum sigma*n, sum (err*n)^2, sum n, files]
+    sums: Dict[str, list] = defaultdict(lambda: [0.0, 0.0, 0, []])
+    skipped = 0
+    for path in sorted(root.rglob("*.root")):
+        # Job outputs or merged files, never both: they hold the same rows
+        if path.name.endswith("_merged.root") != merged:
+            skipped += 1
+            continue
+        root_file = ROOT.TFile.Open(str(path))
+        if not root_file or root_file.IsZombie():
+            print(f"[WARN] Failed to open {path}", file=sys.stderr)
+            continue
+        tree = root_file.Get("GenInfo")
+        if tree:
+            entry = sums[find_pthat_label(path)]
+            for row in tree:
+                entry[0] += row.sigmaGen * row.nAccepted
+                entry[1] += (row.sigmaErr * row.nAccepted) ** 2
+                entry[2] += row.nAccepted
+            entry[3].append(path)
+        root_file.Close()
+    if skipped:
+        kind = "job outputs" if merged else "*_merged.root files"
+        print(f"[INFO] Skipped {skipped} {kind}; they repeat the GenInfo rows read.", file=sys.stderr)
+
+    aggregated: List[AggregatedSigmaRecord] = []
+    for label, (sigma_n, err_n2, n_accepted, paths) in sums.items():
+        if n_accepted <= 0:
+            print(f"[WARN] No accepted events recorded for {label}; skipping.", file=sys.stderr)
+            continue
+        aggregated.append(
+            AggregatedSigmaRecord(
+                pthat_label=label,
+                average_sigma_mb=sigma_n / n_accepted,
+                log_paths=paths,
+                sigma_err_mb=err_n2 ** 0.5 / n_accepted,
+                n_accepted=int(n_accepted),
+            )
+        )
+    return sorted(aggregated, key=lambda rec: pthat_label_sort_key(rec.pthat_label))
+
+
 def format_sigma(value: float) -> str:
     return f"{value:.6e}"
 
 
 def write_report(records: List[AggregatedSigmaRecord], output_path: Path) -> None:
-    lines = ["pthat_label\tsigmaGen_mb\tlog_files"]
+    from_root = any(record.sigma_err_mb is not None for record in records)
+    if from_root:
+        lines = ["pthat_label\tsigmaGen_mb\tsigmaErr_mb\tnAccepted\troot_files"]
+    else:
+        lines = ["pthat_label\tsigmaGen_mb\tlog_files"]
     for record in records:
+        if from_root:
+            lines.append(
+                f"{record.pthat_label}\t{format_sigma(record.average_sigma_mb)}\t"
+                f"{format_sigma(record.sigma_err_mb or 0.0)}\t{record.n_accepted}\t{len(record.log_paths)} files"
+            )
+            continue
         if record.log_paths:
             log_repr = ", ".join(path.as_posix() for path in record.log_paths)
             log_column = f"{len(record.log_paths)} files: {log_repr}"
@@ -194,10 +271,16 @@ def main(argv: Optional[Iterable[str]] = None) -> int:
         print(f"[ERROR] Not a directory: {root_dir}", file=sys.stderr)
         return 1
 
-    records = collect_sigma_records(root_dir, args.encoding)
-    aggregated_records = aggregate_sigma_records(records)
+    if args.from_root:
+        aggregated_records = aggregate_root_files(root_dir, args.merged)
+        records = aggregated_records
+    else:
+        records = collect_sigma_records(root_dir, args.encoding)
+        aggregated_records = aggregate_sigma_records(records)
 
-    if not records:
+    if args.from_root and not aggregated_records:
+        print(f"[WARN] No GenInfo trees found under {root_dir}", file=sys.stderr)
+    elif not records:
         print(f"[WARN] No sigmaGen entries found under {root_dir}", file=sys.stderr)
     elif not aggregated_records:
         print(
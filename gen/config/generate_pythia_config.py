@@ -1,8 +1,14 @@
 #!/usr/bin/env python3
 import argparse
 import json
+import math
 from pathlib import Path
-from typing import List, Sequence
+from typing import Dict, List, Optional, Sequence
+
+# Seeds reserved per pTHat bin. pythia.C gives thread t of job j the seed
+# Random:seed + j * 64 + t, so a bin holds 156250 jobs before reaching the next.
+DEFAULT_SEED_BLOCK = 10_000_000
+MAX_PYTHIA_SEED = 900_000_000
 
 
 def parse_arguments() -> argparse.Namespace:
@@ -14,6 +20,19 @@ def parse_arguments() -> argparse.Namespace:
         required=True,
         help="Path to the JSON configuration file describing pTHat ranges and events.",
     )
+    parser.add_argument(
+        "--measurements",
+        help="JSON with per-bin sigma, fraction and cost, used with 'statistics_target'.",
+    )
+    parser.add_argument(
+        "--measure-from",
+        help="merge_pythia_final.sh output of a pilot run; per-bin measurements are read "
+        "from its pthat_<min>_<max>_merged.root files (needs PyROOT).",
+    )
+    parser.add_argument(
+        "--write-measurements",
+        help="Store the measurements taken with --measure-from in this JSON file.",
+    )
     return parser.parse_args()
 
 
@@ -62,18 +81,179 @@ def update_setting(lines: List[str], key: str, value: str) -> None:
     raise KeyError(f"Setting '{key}' not found in template.")
 
 
+def set_setting(lines: List[str], key: str, value: str) -> None:
+    try:
+        update_setting(lines, key, value)
+    except KeyError:
+        if lines and not lines[-1].endswith("\n"):
+            lines[-1] += "\n"
+        lines.append(f"{key} = {value}\n")
+
+
 def generate_output_filename(base_name: str, pt_min: float, pt_max: float, precision: int) -> str:
     min_token = format_filename_value(pt_min, precision)
     max_token = format_filename_value(pt_max, precision)
     return f"{base_name}_pthat_{min_token}_{max_token}.cmnd"
 
 
+def bin_prefix(pt_min: float, pt_max: float, precision: int) -> str:
+    """Output prefix of a bin in run_PYTHIA.py and merge_pythia_final.sh."""
+    return f"pthat_{format_filename_value(pt_min, precision)}_{format_filename_value(pt_max, precision)}"
+
+
+def measure_bin(merged_file: Path, histogram: str, pt_range: Sequence[float]) -> Optional[Dict[str, float]]:
+    """sigma [mb], entries per event inside pt_range, and CPU seconds per event of one bin.
+
+    Also reports "precision", the largest relative bin error of histogram inside
+    pt_range (unscaled, -1 with an empty bin), reached with "events" events.
+    """
+    if not merged_file.is_file():
+        return None
+    import ROOT
+
+    root_file = ROOT.TFile.Open(str(merged_file))
+    hnevent = root_file.Get("hnevent")
+    hsigma = root_file.Get("hSigmaGen")
+    hist = root_file.Get(histogram)
+    if not hnevent or not hsigma or not hist or hnevent.GetBinContent(1) <= 0:
+        root_file.Close()
+        return None
+    events = hnevent.GetBinContent(1)
+
+    perf = root_file.Get("hPerf")
+    jobs = hsigma.GetEntries()
+    cost = 1.0
+    if perf:
+        axis = perf.GetXaxis()
+        bins = {axis.GetBinLabel(i): perf.GetBinContent(i) for i in range(1, perf.GetNbinsX() + 1)}
+        jobs = bins.get("jobs", jobs)
+        cost = sum(value for label, value in bins.items() if label.startswith("t_") and label != "t_init") / events
+    # hadd sums the per-job hSigmaGen values; GenInfo rows merge properly
+    sigma = hsigma.GetBinContent(1) / max(jobs, 1.0)
+    gen_info = root_file.Get("GenInfo")
+    if gen_info and gen_info.GetEntries() > 0:
+        rows = [(row.sigmaGen, row.nAccepted) for row in gen_info]
+        n_accepted = sum(n for _, n in rows)
+        if n_accepted > 0:
+            sigma = sum(value * n for value, n in rows) / n_accepted
+
+    axis = hist.GetXaxis()
+    first = axis.FindFixBin(pt_range[0])
+    last = axis.FindFixBin(pt_range[1]) - 1
+    fraction = hist.Integral(first, last) / events
+    precision = 0.0
+    for bin_index in range(first, last + 1):
+        content = hist.GetBinContent(bin_index)
+        if content <= 0:
+            precision = -1.0
+            break
+        precision = max(precision, hist.GetBinError(bin_index) / content)
+    root_file.Close()
+    return {"sigma": sigma, "fraction": fraction, "cost": cost, "precision": precision, "events": events}
+
+
+def allocate_events(
+    measurements: Sequence[Dict[str, float]], relative_uncertainty: float, min_events: int
+) -> List[int]:
+    """Events per bin that reach relative_uncertainty on the stitched yield at the lowest CPU.
+
+    The stitched yield is S = sum(sigma_i * f_i) with variance sum(sigma_i^2 f_i / N_i),
+    f_i being the entries per event in range. Minimising sum(c_i N_i) at fixed
+    variance gives N_i proportional to sqrt(a_i / c_i) with a_i = sigma_i^2 f_i.
+    Bins without a positive cost count with the mean cost of the others.
+    """
+    costs = bin_costs(measurements)
+    a = [m["sigma"] ** 2 * m["fraction"] for m in measurements]
+    yield_total = sum(m["sigma"] * m["fraction"] for m in measurements)
+    if yield_total <= 0:
+        raise ValueError("The pilot measurements have no entries in the target range.")
+    variance = (relative_uncertainty * yield_total) ** 2
+    scale = sum(math.sqrt(a_i * c_i) for a_i, c_i in zip(a, costs)) / variance
+    return [max(min_events, math.ceil(scale * math.sqrt(a_i / c_i))) for a_i, c_i in zip(a, costs)]
+
+
+def bin_costs(measurements: Sequence[Dict[str, float]]) -> List[float]:
+    """CPU seconds per event; a bin whose hPerf has no t_* time gets the mean of the others."""
+    known = [m["cost"] for m in measurements if m["cost"] > 0]
+    fallback = sum(known) / len(known) if known else 1.0
+    return [m["cost"] if m["cost"] > 0 else fallback for m in measurements]
+
+
+def precision_events(measurement: Dict[str, float], bin_precision: float) -> Optional[int]:
+    """Events for the largest relative bin error in range to reach bin_precision.
+
+    Scales the pilot's events by (achieved / target)^2; None when the pilot
+    left a bin in range empty or did not record its precision.
+    """
+    achieved = measurement.get("precision", -1.0)
+    if achieved < 0 or "events" not in measurement:
+        return None
+    return math.ceil(measurement["events"] * (achieved / bin_precision) ** 2)
+
+
 def ensure_triplet(entry: Sequence[float]) -> Sequence[float]:
     if len(entry) != 3:
         raise ValueError(f"Each pTHat entry must contain [min, max, events], got: {entry}")
     return entry
 
 
+def statistics_allocation(
+    args: argparse.Namespace, config_dir: Path, pthats_events: Sequence[Sequence[float]], precision: int, target: dict
+) -> List[int]:
+    """Main:numberOfEvents per bin from the 'statistics_target' block.
+
+    Expected keys: histogram (e.g. "hJetPt"), pt_range [min, max], relative_uncertainty,
+    and optionally jobs_per_bin (run_PYTHIA.py totalEvents, default 1000),
+    min_events (per bin, default 1000) and bin_precision: the largest relative
+    bin error of histogram in pt_range every pT-hat bin must reach on its own.
+    Bins whose pilot missed it get at least their pilot events times
+    (achieved / bin_precision)^2.
+    """
+    prefixes = [bin_prefix(entry[0], entry[1], precision) for entry in pthats_events]
+    if args.measure_from:
+        merged_dir = Path(args.measure_from).expanduser().resolve()
+        measurements = {
+            prefix: measure_bin(merged_dir / f"{prefix}_merged.root", target["histogram"], target["pt_range"])
+            for prefix in prefixes
+        }
+        if args.write_measurements:
+            Path(args.write_measurements).write_text(json.dumps(measurements, indent=2) + "\n", encoding="utf-8")
+    elif args.measurements:
+        measurements = load_json_config(Path(args.measurements).expanduser())
+    else:
+        raise ValueError("'statistics_target' needs --measurements or --measure-from.")
+
+    missing = [prefix for prefix in prefixes if not measurements.get(prefix)]
+    if missing:
+        raise ValueError(f"No measurements for bins: {', '.join(missing)}")
+
+    events = allocate_events(
+        [measurements[prefix] for prefix in prefixes],
+        float(target["relative_uncertainty"]),
+        int(target.get("min_events", 1000)),
+    )
+    bin_precision = float(target.get("bin_precision", 0))
+    if bin_precision > 0:
+        for index, prefix in enumerate(prefixes):
+            needed = precision_events(measurements[prefix], bin_precision)
+            if needed is None:
+                print(f"{prefix}: no pilot precision in {target['pt_range']}, bin_precision not applied")
+            elif needed > events[index]:
+                print(f"{prefix}: pilot reached {measurements[prefix]['precision']:.3g}, "
+                      f"raised to {needed} events for {bin_precision}")
+                events[index] = needed
+    jobs_per_bin = int(target.get("jobs_per_bin", 1000))
+    costs = bin_costs([measurements[prefix] for prefix in prefixes])
+    total_cost = 0.0
+    for prefix, n, cost_per_event in zip(prefixes, events, costs):
+        cost = n * cost_per_event
+        total_cost += cost
+        print(f"{prefix}: {n} events ({cost / 3600:.1f} CPU h)")
+    print(f"Total: {sum(events)} events, {total_cost / 3600:.1f} CPU h for "
+          f"{target['relative_uncertainty']} on {target['histogram']} in {target['pt_range']}")
+    return [math.ceil(n / jobs_per_bin) for n in events]
+
+
 def main() -> None:
     args = parse_arguments()
     config_path = Path(args.config).expanduser().resolve()
@@ -110,17 +290,31 @@ def main() -> None:
     if not pthats_events:
         raise ValueError("No 'pthats_events' entries found in configuration.")
 
-    for entry in pthats_events:
-        pt_min, pt_max, events = ensure_triplet(entry)
+    events_per_job = [int(ensure_triplet(entry)[2]) for entry in pthats_events]
+    target = config.get("statistics_target")
+    if target:
+        events_per_job = statistics_allocation(args, config_dir, pthats_events, precision, target)
+
+    base_seed = config.get("seed")
+    seed_block = int(config.get("seed_block", DEFAULT_SEED_BLOCK))
+    if base_seed is not None and int(base_seed) + len(pthats_events) * seed_block > MAX_PYTHIA_SEED:
+        raise ValueError(f"seed {base_seed} with {len(pthats_events)} blocks of {seed_block} exceeds {MAX_PYTHIA_SEED}")
+
+    for bin_index, entry in enumerate(pthats_events):
+        pt_min, pt_max, _ = ensure_triplet(entry)
         lines = list(default_lines)
 
-        events_value = str(int(events))
+        events_value = str(events_per_job[bin_index])
         pt_min_value = format_setting_value(pt_min, precision)
         pt_max_value = format_setting_value(pt_max, precision)
 
         update_setting(lines, "Main:numberOfEvents", events_value)
         update_setting(lines, "PhaseSpace:pTHatMin", pt_min_value)
         update_setting(lines, "PhaseSpace:pTHatMax", pt_max_value)
+        if base_seed is not None:
+            # Every bin starts its own seed block; jobs index into it via --job-index
+            set_setting(lines, "Random:setSeed", "on")
+            set_setting(lines, "Random:seed", str(int(base_seed) + bin_index * seed_block))
 
         output_filename = generate_output_filename(base_name, pt_min, pt_max, precision)
         output_path = output_dir / output_filename
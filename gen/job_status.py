@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+"""
+Summarise the live progress of a run_PYTHIA.py production, per pT-hat bin.
+
+Reads the progress records pythia writes with --status-file (see
+ProgressReport.h) from two places:
+  * the <prefix>_status_<job>.json files Condor brought back into
+    <work_root>/out at exit or eviction, and
+  * with --condor, the PythiaStatus attribute that running jobs publish
+    through condor_chirp, queried with condor_q.
+The newest record of every (bin, job) wins. Each bin gets its job counts,
+events done, median throughput, the longest ETA and the largest RSS. Running
+jobs slower than the bin median by --straggler-factor, or whose elapsed time
+plus ETA exceeds the periodic_remove limit, are listed as stragglers so they
+can be resubmitted early.
+
+    ./job_status.py 20250101_120000_run_config_files_pp_5020GeV_PromptPhoton_all_on --condor
+"""
+
+from __future__ import annotations
+
+import argparse
+import json
+import statistics
+import subprocess
+import sys
+import time
+from collections import defaultdict
+from pathlib import Path
+from typing import Dict, Iterable, List, Optional, Tuple
+
+# periodic_remove of the submit files written by run_PYTHIA.py
+REMOVE_AFTER_SECONDS = 259200
+
+
+def parse_args(argv: Optional[Iterable[str]] = None) -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description="Per-bin progress of a production from its status records.")
+    parser.add_argument("work_root", help="Production directory made by run_PYTHIA.py.")
+    parser.add_argument("--condor", action="store_true", help="Also query running jobs with condor_q.")
+    parser.add_argument("--straggler-factor", type=float, default=2.0,
+                        help="Flag running jobs this many times slower than their bin median (default 2).")
+    parser.add_argument("--json", dest="json_output", help="Also write the summary to this JSON file.")
+    return parser.parse_args(argv)
+
+
+def bin_name(config: str) -> str:
+    """Output prefix of a config, as run_PYTHIA.py names it."""
+    stem = Path(config).stem
+    return "pthat_" + stem.split("pthat_", 1)[1] if "pthat_" in stem else stem
+
+
+def read_status_files(work_root: Path) -> List[dict]:
+    records = []
+    for path in sorted((work_root / "out").glob("**/*_status_*.json")):
+        try:
+            records.append(json.loads(path.read_text(encoding="utf-8")))
+        except (OSError, ValueError):
+            print(f"Skipping unreadable {path}", file=sys.stderr)
+    return records
+
+
+def read_condor_status(work_root: Path) -> List[dict]:
+    # Executables live in <work_root>/macro/<config>/run.sh
+    constraint = f'regexp("/{work_root.name}/macro/", Cmd) && PythiaStatus =!= undefined'
+    try:
+        output = subprocess.run(
+            ["condor_q", "-constraint", constraint, "-json", "-attributes", "ClusterId,ProcId,PythiaStatus"],
+            capture_output=True, text=True, check=True,
+        ).stdout
+    except (OSError, subprocess.CalledProcessError) as error:
+        print(f"condor_q failed: {error}", file=sys.stderr)
+        return []
+    records = []
+    for ad in json.loads(output) if output.strip() else []:
+        try:
+            record = json.loads(ad["PythiaStatus"])
+        except (KeyError, ValueError):
+            continue
+        record["condorJob"] = f"{ad.get('ClusterId')}.{ad.get('ProcId')}"
+        records.append(record)
+    return records
+
+
+def latest_records(records: Iterable[dict]) -> Dict[Tuple[str, int], dict]:
+    latest: Dict[Tuple[str, int], dict] = {}
+    for record in records:
+        key = (bin_name(record.get("config", "")), record.get("jobIndex", 0))
+        if key not in latest or record.get("time", 0) >= latest[key].get("time", 0):
+            latest[key] = record
+    return latest
+
+
+def summarise(latest: Dict[Tuple[str, int], dict], straggler_factor: float) -> Dict[str, dict]:
+    by_bin: Dict[str, List[dict]] = defaultdict(list)
+    for (name, _), record in latest.items():
+        by_bin[name].append(record)
+
+    now = time.time()
+    summary = {}
+    for name, records in sorted(by_bin.items()):
+        running = [record for record in records if record["state"] == "running"]
+        rates = [record["eventsPerSecond"] for record in running if record["eventsPerSecond"] > 0]
+        median_rate = statistics.median(rates) if rates else 0.0
+        stragglers = []
+        for record in running:
+            # Age of the record adds to the elapsed time of a job still running
+            elapsed = record["elapsed"] + max(now - record.get("time", now), 0)
+            slow = median_rate > 0 and record["eventsPerSecond"] * straggler_factor < median_rate
+            overrun = record["eta"] > 0 and elapsed + record["eta"] > REMOVE_AFTER_SECONDS
+            if slow or overrun:
+                stragglers.append({
+                    "jobIndex": record["jobIndex"], "condorJob": record.get("condorJob", ""),
+                    "eventsPerSecond": record["eventsPerSecond"], "eta": record["eta"],
+                    "reason": "overrun" if overrun else "slow",
+                })
+        etas = [record["eta"] for record in running if record["eta"] > 0]
+        summary[name] = {
+            "jobs": len(records),
+            "running": len(running),
+            "done": len(records) - len(running),
+            "events": sum(record["events"] for record in records),
+            "total": sum(record["total"] for record in records),
+            "medianEventsPerSecond": median_rate,
+            "maxEta": max(etas) if etas else 0.0,
+            "maxRSSMB": max(record["peakRSSMB"] for record in records),
+            "stragglers": sorted(stragglers, key=lambda straggler: straggler["jobIndex"]),
+        }
+    return summary
+
+
+def print_summary(summary: Dict[str, dict]) -> None:
+    print(f"{'bin':<24}{'jobs':>6}{'run':>6}{'done':>6}{'events':>14}{'%':>7}{'evt/s':>10}{'max ETA h':>11}"
+          f"{'RSS MB':>9}{'slow':>6}")
+    for name, entry in summary.items():
+        fraction = 100.0 * entry["events"] / entry["total"] if entry["total"] else 0.0
+        print(f"{name:<24}{entry['jobs']:>6}{entry['running']:>6}{entry['done']:>6}{entry['events']:>14}"
+              f"{fraction:>7.1f}{entry['medianEventsPerSecond']:>10.3g}{entry['maxEta'] / 3600:>11.2f}"
+              f"{entry['maxRSSMB']:>9.0f}{len(entry['stragglers']):>6}")
+    for name, entry in summary.items():
+        for straggler in entry["stragglers"]:
+            print(f"  {name} job {straggler['jobIndex']} {straggler['condorJob']}: {straggler['reason']}, "
+                  f"{straggler['eventsPerSecond']:.3g} events/s, ETA {straggler['eta'] / 3600:.1f} h")
+
+
+def main(argv: Optional[Iterable[str]] = None) -> int:
+    args = parse_args(argv)
+    work_root = Path(args.work_root).resolve()
+    if not work_root.is_dir():
+        print(f"{work_root} is not a directory", file=sys.stderr)
+        return 1
+    records = read_status_files(work_root)
+    if args.condor:
+        records += read_condor_status(work_root)
+    if not records:
+        print("No status records found", file=sys.stderr)
+        return 1
+    summary = summarise(latest_records(records), args.straggler_factor)
+    print_summary(summary)
+    if args.json_output:
+        Path(args.json_output).write_text(json.dumps(summary, indent=2) + "\n", encoding="utf-8")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -3,17 +3,29 @@ set -euo pipefail
 
 usage() {
   cat <<'USAGE'
-Usage: merge_pythia_final.sh -i <root_dir> -o <output_dir> [-p <parallel_jobs>]
+Usage: merge_pythia_final.sh -i <root_dir> -o <output_dir> [-p <parallel_jobs>] [-t <threads>] [-u]
 
 Options:
   -i  Directory whose tree contains out/* subfolders with AnalysisResults ROOT files.
   -o  Directory where merged ROOT files will be written.
-  -p  Number of parallel hadd jobs to run (default: number of CPU cores).
+  -p  Number of directories merged at the same time (default: number of CPU cores,
+      or 2 when the mergeResults tool is available).
+  -t  Threads per directory merge (default: CPU cores / parallel jobs).
+  -u  Incremental: fold only inputs that are new since the last merge into the
+      existing merged file. Falls back to a full merge if an input changed.
   -h  Show this help message.
 
 Each subdirectory under an "out" folder containing files that match
 *AnalysisResults_*.root is merged into a single ROOT file within <output_dir>.
 The merged filename is the subdirectory's basename with a _merged.root suffix.
+Merging uses mergeResults (built next to this script by make), which merges
+each directory as a tree on several threads; without it, hadd -j is used.
+Every merged file gets a <merged>.manifest sidecar with the size, mtime and
+path of the inputs it contains, which -u compares against.
+
+Bundled outputs (out/bundle, see bundleTasks in run_PYTHIA.py) hold one
+directory per pT-hat bin; bundle_merged.root is split into the usual
+<bin>_merged.root files afterwards, which needs mergeResults.
 USAGE
 }
 
@@ -43,12 +55,16 @@ format_duration() {
 input_dir=""
 output_dir=""
 parallelism=""
+threads=""
+incremental=0
 
-while getopts ":i:o:p:h" opt; do
+while getopts ":i:o:p:t:uh" opt; do
   case "${opt}" in
     i) input_dir="${OPTARG}" ;;
     o) output_dir="${OPTARG}" ;;
     p) parallelism="${OPTARG}" ;;
+    t) threads="${OPTARG}" ;;
+    u) incremental=1 ;;
     h)
       usage
       exit 0
@@ -64,9 +80,15 @@ if [[ -z "${input_dir}" || -z "${output_dir}" ]]; then
   exit 1
 fi
 
-if ! command -v hadd >/dev/null 2>&1; then
-  err "hadd not found in PATH"
-  exit 1
+script_dir="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+merger="${script_dir}/mergeResults"
+if [[ ! -x "${merger}" ]]; then
+  merger=""
+  if ! command -v hadd >/dev/null 2>&1; then
+    err "Neither mergeResults nor hadd found"
+    exit 1
+  fi
+  info "mergeResults not built, falling back to hadd -j"
 fi
 
 if [[ ! -d "${input_dir}" ]]; then
@@ -76,11 +98,18 @@ fi
 
 mkdir -p "${output_dir}"
 
+if command -v nproc >/dev/null 2>&1; then
+  cores="$(nproc)"
+else
+  cores=1
+fi
+
 if [[ -z "${parallelism}" ]]; then
-  if command -v nproc >/dev/null 2>&1; then
-    parallelism="$(nproc)"
+  # A threaded merge keeps a few cores busy by itself
+  if [[ -n "${merger}" ]]; then
+    parallelism=$(( cores < 2 ? cores : 2 ))
   else
-    parallelism=1
+    parallelism="${cores}"
   fi
 fi
 
@@ -89,6 +118,34 @@ if ! [[ "${parallelism}" =~ ^[0-9]+$ ]] || (( parallelism < 1 )); then
   exit 1
 fi
 
+if [[ -z "${threads}" ]]; then
+  threads=$(( cores / parallelism ))
+  (( threads < 1 )) && threads=1
+fi
+
+if ! [[ "${threads}" =~ ^[0-9]+$ ]] || (( threads < 1 )); then
+  err "Threads must be a positive integer"
+  exit 1
+fi
+
+# Merges the files listed in $2 into $1; the list file keeps 10k+ inputs off the command line.
+# A third argument names a directory to split the merged bundle into.
+merge_files() {
+  local output="${1}"
+  local list_file="${2}"
+  local split_dir="${3:-}"
+  if [[ -n "${merger}" ]]; then
+    "${merger}" "${output}" --inputs-from "${list_file}" --threads "${threads}" ${split_dir:+--split "${split_dir}"}
+  elif [[ -n "${split_dir}" ]]; then
+    err "Splitting bundled outputs needs mergeResults"
+    return 1
+  elif (( threads > 1 )); then
+    hadd -f -j "${threads}" "${output}" "@${list_file}"
+  else
+    hadd -f "${output}" "@${list_file}"
+  fi
+}
+
 search_root="${input_dir%/}"
 mapfile -d '' -t analysis_files < <(find "${search_root}" -type f -name '*AnalysisResults_*.root' -print0)
 
@@ -132,7 +189,7 @@ release_oldest() {
   local label="${job_labels[$pid]}"
   unset "job_labels[$pid]"
   if ! wait "${pid}"; then
-    err "hadd failed for ${label}"
+    err "Merge failed for ${label}"
     exit 1
   fi
 }
@@ -142,7 +199,7 @@ cleanup() {
   for pid in "${pids[@]}"; do
     local label="${job_labels[$pid]}"
     if ! wait "${pid}"; then
-      err "hadd failed for ${label}"
+      err "Merge failed for ${label}"
       exit 1
     fi
     unset "job_labels[$pid]"
@@ -165,15 +222,49 @@ for dir in "${analysis_dirs[@]}"; do
     continue
   fi
 
+  manifest="${output_file}.manifest"
+  new_manifest="${manifest}.new"
+  list_file="${output_file}.inputs"
+  printf '%s\0' "${root_files[@]}" | xargs -0 stat -c '%s %Y %n' | sort > "${new_manifest}"
+
+  merge_target="${output_file}"
+  if (( incremental )) && [[ -f "${output_file}" && -f "${manifest}" ]]; then
+    if [[ -n "$(comm -23 "${manifest}" "${new_manifest}")" ]]; then
+      info "Inputs of ${rel_dir} changed or vanished since the last merge, merging all"
+      printf '%s\n' "${root_files[@]}" > "${list_file}"
+    else
+      mapfile -t added < <(comm -13 "${manifest}" "${new_manifest}" | cut -d' ' -f3-)
+      if (( ${#added[@]} == 0 )); then
+        info "${output_file} is up to date"
+        rm -f "${new_manifest}"
+        continue
+      fi
+      # The previous result is one more input; the new file replaces it at the end
+      merge_target="${output_file}.tmp"
+      printf '%s\n' "${output_file}" "${added[@]}" > "${list_file}"
+      info "Adding ${#added[@]} new files from ${rel_dir} -> ${output_file}"
+    fi
+  else
+    printf '%s\n' "${root_files[@]}" > "${list_file}"
+  fi
+
   take_slot
 
-  info "Merging ${#root_files[@]} files from ${rel_dir} -> ${output_file}"
+  [[ "${merge_target}" == "${output_file}" ]] && info "Merging ${#root_files[@]} files from ${rel_dir} -> ${output_file}"
+
+  split_dir=""
+  [[ "${dir_basename}" == "bundle" ]] && split_dir="${output_dir%/}"
 
   (
-    if hadd -f "${output_file}" "${root_files[@]}"; then
+    if merge_files "${merge_target}" "${list_file}" "${split_dir}"; then
+      [[ "${merge_target}" != "${output_file}" ]] && mv -f "${merge_target}" "${output_file}"
+      # Only recorded once the merged file holds these inputs
+      mv -f "${new_manifest}" "${manifest}"
+      rm -f "${list_file}"
       info "Finished ${output_file}"
     else
-      err "hadd failed for ${dir}"
+      rm -f "${new_manifest}"
+      err "Merge failed for ${dir}"
       exit 1
     fi
   ) &
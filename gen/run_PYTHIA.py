@@ -1,8 +1,11 @@
 #!/usr/bin/env python3
 from datetime import datetime
+import json
+import math
 import subprocess
 import pathlib
 import os
+import re
 import sys
 
 os.umask(0)
@@ -11,7 +14,55 @@ MAINGENERATOR = "run_config_files_pp_5020GeV_PromptPhoton_all_on"
 CONFIG_FILE = "config_files_pp_5020GeV_PromptPhoton_all_on"
 
 ## Default values
+# Jobs per config; each runs Main:numberOfEvents of the .cmnd
 totalEvents = 1000
+# Generation threads per job; each Condor slot then requests the same number of cores
+threadsPerJob = 1
+# Write Pythia's default Settings/ParticleData databases once on the submit node
+# and ship them with every job (XmlCache in gen/pythia.C). Only the xmldoc
+# parsing of each Pythia instance is saved; readFile() and init() still run
+useXmlCache = False
+# Size budget (MB) for the stored TrackEvents tree per job; 0 keeps histograms only
+storeTracksMB = 0
+# Minutes between checkpoints; 0 disables them. Evicted jobs then restart from
+# the last checkpoint instead of from scratch
+checkpointMinutes = 0
+# Adaptive job sizing: when > 0, the events of a bin (totalEvents jobs times
+# Main:numberOfEvents) are regrouped into jobs of about this wall time
+targetJobMinutes = 0
+# Events of the calibration run made per bin on the submit node to measure its
+# throughput, unless perfSourceDir already has a measurement for the bin
+calibrationEvents = 200
+# Optional output directory of merge_pythia_final.sh from an earlier production;
+# the hPerf histograms in its <prefix>_merged.root files replace calibration runs
+perfSourceDir = None
+# Output policy of the jobs (see gen/OutputPolicy.h): compression such as "lz4"
+# (fast merging) or "zstd" (archiving), "" for ROOT's default; floatHists writes
+# the analysis histograms as TH1F
+outputCompression = ""
+floatHists = False
+# Minutes between live progress records (see gen/ProgressReport.h); 0 (default)
+# disables them. Jobs then publish them through condor_chirp and bring the last
+# one back as <prefix>_status_<job>.json; gen/job_status.py summarises them per bin
+statusMinutes = 0
+# Convergence stop (see gen/Convergence.h): jobs end early once the largest
+# relative bin error of targetHistogram (NAME or NAME:LO:HI) is at most
+# targetPrecision, or after maxJobMinutes of wall time; 0 disables either.
+# The precision is per job; N jobs of a bin merge to about targetPrecision/sqrt(N)
+targetPrecision = 0
+targetHistogram = "hJetPt:20:100"
+maxJobMinutes = 0
+# HepMC3 export of every generated event (see gen/HepMCExport.h; needs pythia
+# built with make WITH_HEPMC3=1): "hepmc", "hepmc.gz" or "root" for
+# <prefix>_events_<job>.<ext>, "" disables it. hepmcDiskMB is added to the
+# disk request of each job
+hepmcOutput = ""
+hepmcDiskMB = 2000
+# Bundling: when > 0, the (bin, job index) tasks of all configs are dealt out in
+# slices of this many to Condor jobs that run them with ./pythia --worker and
+# write one file with a directory per bin (merged and split again by
+# merge_pythia_final.sh). One DAG instead of one per config
+bundleTasks = 0
 print(f"Total events: {totalEvents}")
 
 # Below should not be modified ##########################################
@@ -26,6 +77,78 @@ log_root = work_root / "logs"
 for directory in (macro_root, out_root, log_root):
     directory.mkdir(parents=True, exist_ok=True)
 
+
+def set_number_of_events(cmnd_text, events):
+    return re.sub(r"^(\s*Main:numberOfEvents\s*=\s*)\d+", rf"\g<1>{events}", cmnd_text, count=1, flags=re.MULTILINE)
+
+
+def number_of_events(cmnd_text):
+    match = re.search(r"^\s*Main:numberOfEvents\s*=\s*(\d+)", cmnd_text, re.MULTILINE)
+    if not match:
+        raise RuntimeError("Main:numberOfEvents not found")
+    return int(match.group(1))
+
+
+def read_perf_histogram(merged_file):
+    """hPerf bins of a merged output (summed over its jobs), or None."""
+    if not merged_file.is_file():
+        return None
+    import ROOT
+
+    root_file = ROOT.TFile.Open(str(merged_file))
+    hist = root_file.Get("hPerf") if root_file else None
+    if not hist:
+        return None
+    axis = hist.GetXaxis()
+    perf = {axis.GetBinLabel(i): hist.GetBinContent(i) for i in range(1, hist.GetNbinsX() + 1)}
+    root_file.Close()
+    return perf
+
+
+def run_calibration(config_path, macro_dir, log_dir):
+    """Runs calibrationEvents of the bin with the job's thread count and returns its perf JSON."""
+    calibration_cmnd = macro_dir / "calibration.cmnd"
+    calibration_cmnd.write_text(
+        set_number_of_events(config_path.read_text(encoding="utf-8"), calibrationEvents), encoding="utf-8"
+    )
+    perf_json = macro_dir / "calibration_perf.json"
+    with (log_dir / "calibration.log").open("w", encoding="utf-8") as log:
+        subprocess.run(
+            ["./pythia", "1", str(macro_dir / "calibration.root"), str(calibration_cmnd),
+             "--threads", str(threadsPerJob), "--perf-json", str(perf_json)],
+            cwd=mainDir, stdout=log, stderr=subprocess.STDOUT, check=True,
+        )
+    return json.loads(perf_json.read_text(encoding="utf-8"))
+
+
+def plan_jobs(perf, events_total):
+    """Events per job and job count that fill targetJobMinutes, plus the memory to request."""
+    jobs = perf.get("jobs", 1.0)
+    threads = max(perf["threads"], 1.0)
+    # Threads initialise in parallel, so the init wall time of a job is the thread mean
+    init_seconds = perf["t_init"] / threads
+    event_seconds = max(perf["wall"] - jobs * init_seconds, 1e-9) / max(perf["events"], 1.0)
+    # Event throughput scales with the threads of the job measured
+    event_seconds *= (threads / jobs) / threadsPerJob
+    events_per_job = int((targetJobMinutes * 60 - init_seconds) / event_seconds)
+    events_per_job = min(max(events_per_job, 1), events_total)
+    n_jobs = math.ceil(events_total / events_per_job)
+    memory_mb = max(100 * threadsPerJob, math.ceil(1.5 * perf["peakRSS"] / jobs))
+    return events_per_job, n_jobs, memory_mb, init_seconds + events_per_job * event_seconds
+
+
+job_plan = {}
+# Bundling: task lines for pythia --worker and the files the jobs need
+bundle_tasks = []
+bundle_inputs = []
+bundle_memory_mb = 100 * threadsPerJob
+if bundleTasks > 0 and storeTracksMB > 0:
+    raise RuntimeError("Bundled jobs cannot store tracks; set storeTracksMB = 0")
+if bundleTasks > 0 and hepmcOutput:
+    raise RuntimeError('Bundled jobs cannot export HepMC3 events; set hepmcOutput = ""')
+# condor_chirp needs the IO proxy, only asked for when jobs report their status
+io_proxy_line = "\n+WantIOProxy            = true" if statusMinutes > 0 else ""
+
 config_dir = pathlib.Path(mainDir) / CONFIG_FILE
 
 if not config_dir.is_dir():
@@ -36,6 +159,20 @@ config_files = sorted(config_dir.glob("*.cmnd"))
 if not config_files:
     raise RuntimeError(f"No .cmnd files found in {config_dir}")
 
+# One XML database cache serves every config
+xml_cache_name = "pythia.xmlcache"
+xml_cache_args = ""
+xml_cache_input = ""
+if useXmlCache:
+    subprocess.run(
+        ["./pythia", "0", os.devnull, str(config_files[0]), "--xml-cache", str(macro_root / xml_cache_name),
+         "--prepare-xml-cache"],
+        cwd=mainDir,
+        check=True,
+    )
+    xml_cache_args = f" --xml-cache {xml_cache_name}"
+    xml_cache_input = f",{work_root_name}/macro/{xml_cache_name}"
+
 for config_path in config_files:
     config_name = config_path.name
     config_stem = config_path.stem
@@ -54,6 +191,75 @@ for config_path in config_files:
     config_out_dir.mkdir(parents=True, exist_ok=True)
     config_log_dir.mkdir(parents=True, exist_ok=True)
 
+    n_jobs = totalEvents
+    request_memory_mb = 100 * threadsPerJob
+    if targetJobMinutes > 0:
+        # Planned copy of the .cmnd in the macro directory; jobs get this one
+        config_text = config_path.read_text(encoding="utf-8")
+        events_total = totalEvents * number_of_events(config_text)
+        perf = read_perf_histogram(pathlib.Path(perfSourceDir) / f"{output_prefix}_merged.root") if perfSourceDir else None
+        if perf is None:
+            perf = run_calibration(config_path, config_macro_dir, config_log_dir)
+        events_per_job, n_jobs, request_memory_mb, job_seconds = plan_jobs(perf, events_total)
+        config_path = config_macro_dir / config_name
+        config_path.write_text(set_number_of_events(config_text, events_per_job), encoding="utf-8")
+        job_plan[config_stem] = {
+            "events": events_total, "events_per_job": events_per_job, "jobs": n_jobs,
+            "expected_job_minutes": round(job_seconds / 60, 1), "request_memory_mb": request_memory_mb,
+        }
+        print(f"{config_stem}: {n_jobs} jobs x {events_per_job} events, ~{job_seconds / 60:.1f} min each")
+
+    store_args = f" --store-tracks --store-max-mb {storeTracksMB}" if storeTracksMB > 0 else ""
+    output_args = f" --compression {outputCompression}" if outputCompression else ""
+    if floatHists:
+        output_args += " --float-hists"
+    if targetPrecision > 0:
+        output_args += f" --target-precision {targetPrecision} --target-hist {targetHistogram}"
+    if maxJobMinutes > 0:
+        output_args += f" --max-seconds {maxJobMinutes * 60}"
+    hepmc_args = f' --hepmc "${{OUTPUT_PREFIX}}_events_${{JOB_INDEX}}.{hepmcOutput}"' if hepmcOutput else ""
+    # The tracks are held twice at the end, in AnalysisResults.root and in its
+    # copy under the output name; each file also has the histograms and may pass
+    # the budget by the size estimate of the last baskets (see gen/TrackStore.h)
+    request_disk_mb = max(10, 2 * (storeTracksMB + 2)) + (hepmcDiskMB if hepmcOutput else 0)
+
+    # pythia derives the seeds from Random:seed and the job index, which also
+    # makes a restarted job find its checkpoint again
+    if not re.search(r"^\s*Random:seed\s*=", config_path.read_text(encoding="utf-8"), re.MULTILINE):
+        raise RuntimeError(f"{config_path} has no Random:seed; regenerate it with config/generate_pythia_config.py")
+
+    checkpoint_args = ""
+    checkpoint_setup = ""
+    checkpoint_cleanup = ""
+    output_files = f"{output_prefix}_AnalysisResults_$(process).root"
+    when_to_transfer = "ON_EXIT"
+    status_args = ""
+    if statusMinutes > 0:
+        status_args = f' --status-file "${{OUTPUT_PREFIX}}_status_${{JOB_INDEX}}.json" --status-seconds {statusMinutes * 60} --chirp'
+        output_files += f",{output_prefix}_status_$(process).json"
+    if hepmcOutput:
+        output_files += f",{output_prefix}_events_$(process).{hepmcOutput}"
+    if checkpointMinutes > 0:
+        checkpoint_args = f" --checkpoint-seconds {checkpointMinutes * 60} --checkpoint-dir checkpoint"
+        checkpoint_setup = "\nmkdir -p checkpoint\n"
+        checkpoint_cleanup = "\nrm -f checkpoint/*"
+        output_files += ",checkpoint"
+        when_to_transfer = "ON_EXIT_OR_EVICT"
+
+    rel_config_path = os.path.relpath(config_path.resolve(), mainDir)
+
+    if bundleTasks > 0:
+        # Consecutive tasks of a bin stay together, so a worker initialises
+        # Pythia about once per bin of its slice
+        for job_index in range(n_jobs):
+            bundle_tasks.append(
+                f"-1 AnalysisResults.root:{output_prefix} {config_name} --job-index {job_index}"
+                f" --threads {threadsPerJob}{xml_cache_args}{checkpoint_args}{output_args}"
+            )
+        bundle_inputs.append(rel_config_path)
+        bundle_memory_mb = max(bundle_memory_mb, request_memory_mb)
+        continue
+
     run_script_path = config_macro_dir / "run.sh"
     run_script_path.write_text(
         f"""#!/bin/bash
@@ -62,17 +268,14 @@ echo "INIT! $1 $2 $3 $4 $5"
 
 source alienv_envset.sh
 
-RANDOM_SEED=$(od -vAn -N4 -tu4 < /dev/urandom | tr -d " ")
-RANDOM_SEED=$(( RANDOM_SEED % 10001 ))
-
 CONFIG_FILE="{config_name}"
 JOB_INDEX=${{2:-0}}
 OUTPUT_PREFIX="{output_prefix}"
-
-./pythia $RANDOM_SEED AnalysisResults.root "$CONFIG_FILE"
+{checkpoint_setup}
+./pythia -1 AnalysisResults.root "$CONFIG_FILE" --job-index $JOB_INDEX --threads {threadsPerJob}{xml_cache_args}{store_args}{checkpoint_args}{output_args}{status_args}{hepmc_args}
 
 OUTPUT_FILE="${{OUTPUT_PREFIX}}_AnalysisResults_${{JOB_INDEX}}.root"
-cp -f AnalysisResults.root "${{OUTPUT_FILE}}"
+cp -f AnalysisResults.root "${{OUTPUT_FILE}}"{checkpoint_cleanup}
 
 ls -althr # Check the output files before finish
 echo "DONE!"
@@ -81,8 +284,6 @@ echo "DONE!"
     )
     run_script_path.chmod(0o775)
 
-    rel_config_path = os.path.relpath(config_path.resolve(), mainDir)
-
     condor_sub_path = config_macro_dir / "condor.sub"
     condor_sub_path.write_text(
         f"""Universe                = vanilla
@@ -93,17 +294,18 @@ Log                     = {work_root_name}/logs/{config_stem}/$(process).log
 Output                  = {work_root_name}/logs/{config_stem}/$(process).out
 Error                   = {work_root_name}/logs/{config_stem}/$(process).error
 
-request_memory          = 100MB
-request_disk            = 10MB
-transfer_input_files    = alienv_envset.sh,pythia,{rel_config_path}
-transfer_output_files   = {output_prefix}_AnalysisResults_$(process).root
+request_cpus            = {threadsPerJob}
+request_memory          = {request_memory_mb}MB
+request_disk            = {request_disk_mb}MB
+transfer_input_files    = alienv_envset.sh,pythia,{rel_config_path}{xml_cache_input}
+transfer_output_files   = {output_files}
 arguments               = "$(Opt) $(process)"
 should_transfer_files   = YES
-when_to_transfer_output = ON_EXIT
+when_to_transfer_output = {when_to_transfer}
 periodic_remove = (CurrentTime - EnteredCurrentStatus) > 259200
-output_destination      = file://{work_root}/out/{output_prefix}/
+output_destination      = file://{work_root}/out/{output_prefix}/{io_proxy_line}
 
-Queue {totalEvents} Opt in ({MAINGENERATOR})
+Queue {n_jobs} Opt in ({MAINGENERATOR})
 """,
         encoding="utf-8",
     )
@@ -114,7 +316,7 @@ Queue {totalEvents} Opt in ({MAINGENERATOR})
     )
 
     submit_cmd = (
-        f'condor_submit_dag -batch-name {MAINGENERATOR}_{config_stem}_{totalEvents} '
+        f'condor_submit_dag -batch-name {MAINGENERATOR}_{config_stem}_{n_jobs} '
         f'-force -append "Accounting_Group=group_alice" '
         f'{work_root_name}/macro/{config_stem}/condor.dag'
     )
@@ -125,3 +327,90 @@ Queue {totalEvents} Opt in ({MAINGENERATOR})
     print(stdout.decode("utf-8"))
     if stderr:
         print(stderr.decode("utf-8"), file=sys.stderr)
+
+if bundle_tasks:
+    bundle_dir = macro_root / "bundle"
+    bundle_out_dir = out_root / "bundle"
+    bundle_log_dir = log_root / "bundle"
+    for directory in (bundle_dir, bundle_out_dir, bundle_log_dir):
+        directory.mkdir(parents=True, exist_ok=True)
+    (bundle_dir / "tasks.txt").write_text("\n".join(bundle_tasks) + "\n", encoding="utf-8")
+    n_bundles = math.ceil(len(bundle_tasks) / bundleTasks)
+
+    checkpoint_setup = "\nmkdir -p checkpoint\n" if checkpointMinutes > 0 else ""
+    checkpoint_cleanup = "\nrm -f checkpoint/*" if checkpointMinutes > 0 else ""
+    output_files = "bundle_AnalysisResults_$(process).root" + (",checkpoint" if checkpointMinutes > 0 else "")
+    when_to_transfer = "ON_EXIT_OR_EVICT" if checkpointMinutes > 0 else "ON_EXIT"
+    status_args = ""
+    if statusMinutes > 0:
+        status_args = f' --status-file "bundle_status_${{BUNDLE_INDEX}}.json" --status-seconds {statusMinutes * 60} --chirp'
+        output_files += ",bundle_status_$(process).json"
+
+    run_script_path = bundle_dir / "run.sh"
+    run_script_path.write_text(
+        f"""#!/bin/bash
+
+echo "INIT! $1 $2 $3 $4 $5"
+
+source alienv_envset.sh
+
+BUNDLE_INDEX=${{2:-0}}
+FIRST=$(( BUNDLE_INDEX * {bundleTasks} + 1 ))
+LAST=$(( FIRST + {bundleTasks} - 1 ))
+sed -n "${{FIRST}},${{LAST}}p" tasks.txt > queue.txt
+{checkpoint_setup}
+./pythia --worker queue.txt{status_args}
+
+OUTPUT_FILE="bundle_AnalysisResults_${{BUNDLE_INDEX}}.root"
+cp -f AnalysisResults.root "${{OUTPUT_FILE}}"{checkpoint_cleanup}
+
+ls -althr # Check the output files before finish
+echo "DONE!"
+""",
+        encoding="utf-8",
+    )
+    run_script_path.chmod(0o775)
+
+    condor_sub_path = bundle_dir / "condor.sub"
+    condor_sub_path.write_text(
+        f"""Universe                = vanilla
+Executable              = {work_root_name}/macro/bundle/run.sh
+Accounting_Group        = group_alice
+JobBatchName            = {work_root_name}_bundle_$(process)
+Log                     = {work_root_name}/logs/bundle/$(process).log
+Output                  = {work_root_name}/logs/bundle/$(process).out
+Error                   = {work_root_name}/logs/bundle/$(process).error
+
+request_cpus            = {threadsPerJob}
+request_memory          = {bundle_memory_mb}MB
+request_disk            = 10MB
+transfer_input_files    = alienv_envset.sh,pythia,{work_root_name}/macro/bundle/tasks.txt,{",".join(bundle_inputs)}{xml_cache_input}
+transfer_output_files   = {output_files}
+arguments               = "$(Opt) $(process)"
+should_transfer_files   = YES
+when_to_transfer_output = {when_to_transfer}
+periodic_remove = (CurrentTime - EnteredCurrentStatus) > 259200
+output_destination      = file://{work_root}/out/bundle/{io_proxy_line}
+
+Queue {n_bundles} Opt in ({MAINGENERATOR})
+""",
+        encoding="utf-8",
+    )
+    (bundle_dir / "condor.dag").write_text(f"JOB A {work_root_name}/macro/bundle/condor.sub\n", encoding="utf-8")
+    print(f"Bundles: {len(bundle_tasks)} tasks in {n_bundles} jobs of up to {bundleTasks}")
+
+    submit_cmd = (
+        f'condor_submit_dag -batch-name {MAINGENERATOR}_bundle_{n_bundles} '
+        f'-force -append "Accounting_Group=group_alice" '
+        f'{work_root_name}/macro/bundle/condor.dag'
+    )
+    process = subprocess.Popen(
+        [submit_cmd], shell=True, cwd=mainDir, stdout=subprocess.PIPE, stderr=subprocess.PIPE
+    )
+    stdout, stderr = process.communicate()
+    print(stdout.decode("utf-8"))
+    if stderr:
+        print(stderr.decode("utf-8"), file=sys.stderr)
+
+if job_plan:
+    (work_root / "job_plan.json").write_text(json.dumps(job_plan, indent=2) + "\n", encoding="utf-8")
@@ -6,23 +6,40 @@ Steps:
 1. Read bin configuration from pthat_add_config.json (or a user-specified file).
 2. For each enabled bin: open the ROOT file, scale all TH1 objects, keep copies for plotting.
 3. Draw the selected histogram from every bin plus their sum on one canvas.
-4. Save the scaled copies into temporary files and call the ROOT `hadd` utility to
-   build the summed ROOT file alongside a PDF plot.
+4. Build the summed ROOT file alongside a PDF plot. With gen/stitchBins built,
+   it reads every bin once and writes the weighted sum directly; otherwise the
+   scaled copies are saved into temporary files and summed with `hadd`. Both
+   give the same file: trees are dropped and the job bookkeeping histograms are
+   summed unscaled.
+
+A bin's "scale_factor" is "auto" (the default) to read sigmaGen / sumW from the
+file's GenInfo rows, or a number to override it.
 
 Use `--input-dir` to point at the directory that contains the ROOT files listed in the config
 and `--output-dir`/`--output-name` to select where the combined results are written.
+`--objects` restricts the combined file to matching objects. Objects are located by their
+keys, so only the drawn histogram and the selected objects are ever read from disk.
+
+Batch mode: `--histograms 'hJetPt*,hTrackPt'` reads every bin file once, scales and sums
+all histograms in memory, writes the combined ROOT file from those sums, and renders a
+PDF/PNG per matching histogram (<output stem>_<histogram>.pdf) in `--plot-workers`
+processes. Like stitchBins, trees are not combined and the job bookkeeping histograms
+are summed unscaled.
 """
 
 from __future__ import annotations
 
 import argparse
+import fnmatch
 import json
-import math
+import multiprocessing
+import os
+import shutil
 import subprocess
 import tempfile
 from dataclasses import dataclass
 from pathlib import Path
-from typing import List, Optional, Tuple
+from typing import Dict, List, Optional, Tuple
 
 import ROOT  # type: ignore[attr-defined]
 
@@ -58,6 +75,18 @@ def parse_args() -> argparse.Namespace:
         default=None,
         help="Name of the histogram to draw. Defaults to the first TH1 found.",
     )
+    parser.add_argument(
+        "--histograms",
+        default=None,
+        help="Comma-separated names or globs of the histograms to plot in batch mode; every "
+        "bin file is then read once and the combined file is written from memory.",
+    )
+    parser.add_argument(
+        "--plot-workers",
+        type=int,
+        default=os.cpu_count() or 1,
+        help="Processes rendering the batch-mode plots (default: %(default)s).",
+    )
     parser.add_argument(
         "--debug",
         action="store_true",
@@ -81,6 +110,25 @@ def parse_args() -> argparse.Namespace:
         help="Output ROOT file name (PDF will use the same stem). "
         "Defaults to %(default)s.",
     )
+    parser.add_argument(
+        "--objects",
+        default=None,
+        help="Comma-separated names or globs (e.g. 'hJetPt*,jets/*') of the objects to "
+        "write to the combined file. Matched against the full path and the bare name; "
+        "other objects are never read. Defaults to all objects.",
+    )
+    parser.add_argument(
+        "--stitcher",
+        default=None,
+        help="Path of the stitchBins executable. Defaults to gen/stitchBins of this "
+        "repository or stitchBins on PATH; without it, scaled copies are hadd-ed.",
+    )
+    parser.add_argument(
+        "--threads",
+        type=int,
+        default=1,
+        help="Threads for stitchBins, 0 for all cores (default: %(default)s).",
+    )
     return parser.parse_args()
 
 
@@ -93,6 +141,43 @@ def ensure_parent_dir(path: Path) -> None:
     path.parent.mkdir(parents=True, exist_ok=True)
 
 
+def auto_scale_factor(path: Path) -> float:
+    """sigmaGen / sum of weights of a merged generator output.
+
+    Normalises weighted (PhaseSpace:bias2Selection) and unweighted productions
+    alike. Uses the GenInfo rows when present; otherwise the mean of the
+    per-job hSigmaGen values, which hadd sums.
+    """
+    root_file = open_root_file(path)
+    gen_info = root_file.Get("GenInfo")
+    if gen_info and gen_info.GetEntries() > 0:
+        sigma_n = n_accepted = sum_w = 0.0
+        for row in gen_info:
+            sigma_n += row.sigmaGen * row.nAccepted
+            n_accepted += row.nAccepted
+            sum_w += row.sumW
+        root_file.Close()
+        if n_accepted <= 0 or sum_w <= 0:
+            raise RuntimeError(f"{path} has no accepted events in GenInfo.")
+        return sigma_n / n_accepted / sum_w
+
+    sigma_hist = root_file.Get("hSigmaGen")
+    sumw_hist = root_file.Get("hSumW")
+    if not sigma_hist or not sumw_hist or sumw_hist.GetBinContent(1) <= 0.0:
+        root_file.Close()
+        raise RuntimeError(f"{path} has no hSigmaGen/hSumW; give a numeric scale_factor instead.")
+    jobs = sigma_hist.GetEntries()
+    perf_hist = root_file.Get("hPerf")
+    if perf_hist:
+        jobs_bin = perf_hist.GetXaxis().FindFixBin("jobs")
+        if jobs_bin > 0:
+            jobs = perf_hist.GetBinContent(jobs_bin)
+    sigma = sigma_hist.GetBinContent(1) / max(jobs, 1.0)
+    scale = sigma / sumw_hist.GetBinContent(1)
+    root_file.Close()
+    return scale
+
+
 def build_bin_configs(raw_config: dict, input_dir: Path) -> List[BinConfig]:
     input_dir = input_dir.resolve()
     color_cycle = [
@@ -111,13 +196,20 @@ def build_bin_configs(raw_config: dict, input_dir: Path) -> List[BinConfig]:
     bins: List[BinConfig] = []
     for idx, raw_bin in enumerate(raw_config.get("pthat_bins", [])):
         color = color_cycle[idx % len(color_cycle)]
+        filename = (input_dir / raw_bin["file"]).resolve()
+        include = raw_bin.get("include", True)
+        # "auto" reads the normalisation from the file instead of a hand-copied number
+        scale_factor = raw_bin.get("scale_factor", "auto")
+        if scale_factor == "auto":
+            # Missing files are skipped later, as with a numeric factor
+            scale_factor = auto_scale_factor(filename) if include and filename.exists() else 1.0
         bins.append(
             BinConfig(
                 name=raw_bin["name"],
-                filename=(input_dir / raw_bin["file"]).resolve(),
-                include=raw_bin.get("include", True),
+                filename=filename,
+                include=include,
                 use_scale=raw_bin.get("use_scale_factor", False),
-                scale_factor=float(raw_bin["scale_factor"]),
+                scale_factor=float(scale_factor),
                 color=color,
                 range_min=raw_bin.get("range", {}).get("min"),
                 range_max=raw_bin.get("range", {}).get("max"),
@@ -155,7 +247,47 @@ def clone_and_scale_histogram(
     return hist
 
 
-def create_weighted_copy(source: Path, weight: float, work_dir: Path) -> Path:
+def parse_object_filter(spec: Optional[str]) -> Optional[List[str]]:
+    if not spec:
+        return None
+    return [pattern.strip() for pattern in spec.split(",") if pattern.strip()]
+
+
+def object_selected(full_name: str, object_filter: Optional[List[str]]) -> bool:
+    if object_filter is None:
+        return True
+    base_name = full_name.split("/")[-1]
+    return any(
+        fnmatch.fnmatchcase(full_name, pattern) or fnmatch.fnmatchcase(base_name, pattern)
+        for pattern in object_filter
+    )
+
+
+def _iter_keys_recursively(root_dir, prefix: str = ""):
+    """Yield (full name, key, class) for the latest cycle of every object.
+
+    Only the key headers are read here; directories are opened to descend, any
+    other object stays on disk until the caller reads the key.
+    """
+    seen = set()
+    for key in root_dir.GetListOfKeys():
+        # Keys come highest cycle first; older cycles of a name are stale
+        if key.GetName() in seen:
+            continue
+        seen.add(key.GetName())
+        cls = ROOT.TClass.GetClass(key.GetClassName())
+        if not cls:
+            continue
+        name = f"{prefix}/{key.GetName()}" if prefix else key.GetName()
+        if cls.InheritsFrom("TDirectory"):
+            yield from _iter_keys_recursively(key.ReadObj(), name)
+        else:
+            yield name, key, cls
+
+
+def create_weighted_copy(
+    source: Path, weight: float, work_dir: Path, object_filter: Optional[List[str]] = None
+) -> Path:
     if weight <= 0.0:
         raise RuntimeError(f"Cannot scale file {source} with non-positive weight {weight}.")
     if not source.exists():
@@ -172,46 +304,32 @@ def create_weighted_copy(source: Path, weight: float, work_dir: Path) -> Path:
         src_file.Close()
         raise RuntimeError(f"Failed to create temporary file {target} for scaled copy.")
 
-    def recurse_copy(src_dir, dst_dir) -> None:
-        for key in src_dir.GetListOfKeys():
-            obj = key.ReadObj()
-            if obj.InheritsFrom("TDirectory"):
-                dst_dir.cd()
-                sub_dir = dst_dir.GetDirectory(key.GetName())
-                if not sub_dir:
-                    sub_dir = dst_dir.mkdir(key.GetName())
-                if not sub_dir:
-                    raise RuntimeError(
-                        f"Failed to create subdirectory '{key.GetName()}' in temporary file {target}."
-                    )
-                sub_dir.cd()
-                recurse_copy(obj, sub_dir)
-            else:
-                dst_dir.cd()
-                clone = obj.Clone()
-                if clone.InheritsFrom("TH1"):
-                    clone.Scale(weight)
-                    if hasattr(clone, "SetDirectory"):
-                        clone.SetDirectory(dst_dir)
-                clone.Write()
-
-    recurse_copy(src_file, target_file)
+    # Same objects and weights as gen/stitchBins.C: histograms only (tree rows
+    # would mix bins of different weight), the bookkeeping ones left unscaled
+    for full_name, key, cls in _iter_keys_recursively(src_file):
+        if not cls.InheritsFrom("TH1") or not object_selected(full_name, object_filter):
+            continue
+        dir_name = full_name.rpartition("/")[0]
+        if dir_name and not target_file.GetDirectory(dir_name):
+            target_file.mkdir(dir_name, "", True)
+        dst_dir = target_file.GetDirectory(dir_name) if dir_name else target_file
+        if not dst_dir:
+            raise RuntimeError(f"Failed to create subdirectory '{dir_name}' in temporary file {target}.")
+        dst_dir.cd()
+        clone = key.ReadObj().Clone()
+        if not is_bookkeeping(full_name):
+            # Errors of the scaled sum need the squared weights
+            if clone.GetSumw2N() == 0:
+                clone.Sumw2()
+            clone.Scale(weight)
+        clone.SetDirectory(dst_dir)
+        clone.Write()
     target_file.Write()
     target_file.Close()
     src_file.Close()
     return target
 
 
-def _iter_histograms_recursively(root_obj, prefix: str = ""):
-    for key in root_obj.GetListOfKeys():
-        obj = key.ReadObj()
-        name = f"{prefix}/{key.GetName()}" if prefix else key.GetName()
-        if obj.InheritsFrom("TDirectory"):
-            yield from _iter_histograms_recursively(obj, name)
-        elif obj.InheritsFrom("TH1"):
-            yield name, obj
-
-
 def _histogram_name_matches(candidate: str, requested: str) -> bool:
     if candidate == requested:
         return True
@@ -233,17 +351,16 @@ def _find_positive_minimum(hist: ROOT.TH1) -> Optional[float]:
 def collect_histograms(
     bins: List[BinConfig],
     histogram_to_draw: Optional[str],
-    temp_dir: Path,
     debug: bool = False,
 ) -> Tuple[
     List[Tuple[BinConfig, ROOT.TH1]],
     str,
-    List[Path],
+    List[Tuple[Path, float]],
     ROOT.TH1,
 ]:
     histograms_for_plot: List[Tuple[BinConfig, ROOT.TH1]] = []
     selected_histogram: Optional[str] = None
-    scaled_files: List[Path] = []
+    weighted_inputs: List[Tuple[Path, float]] = []
     combined_hist: Optional[ROOT.TH1] = None
 
     for bin_cfg in bins:
@@ -265,22 +382,21 @@ def collect_histograms(
         if debug:
             print(f"[DEBUG] Processing {bin_cfg.filename} with weight {weight}")
 
-        if math.isclose(weight, 1.0, rel_tol=1e-12, abs_tol=1e-12):
-            scaled_path = bin_cfg.filename
-        else:
-            scaled_path = create_weighted_copy(bin_cfg.filename, weight, temp_dir)
-        scaled_files.append(scaled_path)
+        weighted_inputs.append((bin_cfg.filename, weight))
 
         root_file = open_root_file(bin_cfg.filename)
         try:
-            for full_name, obj in _iter_histograms_recursively(root_file):
+            for full_name, key, cls in _iter_keys_recursively(root_file):
+                if not cls.InheritsFrom("TH1"):
+                    continue
                 if selected_histogram is None:
                     if histogram_to_draw is None or _histogram_name_matches(full_name, histogram_to_draw):
                         selected_histogram = full_name
                 if selected_histogram is None or full_name != selected_histogram:
-                    obj.Delete()
                     continue
 
+                # The only histogram of the bin that gets read
+                obj = key.ReadObj()
                 hist = clone_and_scale_histogram(obj, bin_cfg)
                 obj.Delete()
                 histograms_for_plot.append((bin_cfg, hist))
@@ -289,6 +405,7 @@ def collect_histograms(
                     combined_hist.SetDirectory(0)
                 else:
                     combined_hist.Add(hist)
+                break
         finally:
             root_file.Close()
 
@@ -299,7 +416,7 @@ def collect_histograms(
             f"Selected histogram '{selected_histogram}' was not found in the included bins."
         )
 
-    return histograms_for_plot, selected_histogram, scaled_files, combined_hist
+    return histograms_for_plot, selected_histogram, weighted_inputs, combined_hist
 
 
 def draw_histograms(
@@ -383,6 +500,134 @@ def draw_histograms(
     canvas.SaveAs(str(output_png))
 
 
+# Job bookkeeping (events, weights, seconds) and the timing histograms stay
+# totals, as in gen/stitchBins.C
+BOOKKEEPING_HISTOGRAMS = {
+    "hnevent", "hSumW", "hSigmaGen", "hPerf", "hConvergence", "hVeto", "hJetFindTime", "hJetFindTimeVsMult"
+}
+BOOKKEEPING_PREFIXES = ("hBenchClust_",)
+
+
+def is_bookkeeping(full_name: str) -> bool:
+    return full_name in BOOKKEEPING_HISTOGRAMS or full_name.startswith(BOOKKEEPING_PREFIXES)
+
+
+def load_bins_once(
+    bins: List[BinConfig],
+    plot_patterns: List[str],
+    object_filter: Optional[List[str]],
+    debug: bool = False,
+) -> Tuple[Dict[str, List[Tuple[BinConfig, ROOT.TH1]]], Dict[str, ROOT.TH1], List[str]]:
+    """Reads each included bin file once.
+
+    Returns the scaled per-bin copies of the histograms to plot, the weighted sums
+    of those and of every histogram selected for the combined file, and the names
+    (in file order) of the ones to write.
+    """
+    plots: Dict[str, List[Tuple[BinConfig, ROOT.TH1]]] = {}
+    sums: Dict[str, ROOT.TH1] = {}
+    written: List[str] = []
+
+    for bin_cfg in bins:
+        weight = bin_cfg.scale_factor if bin_cfg.use_scale else 1.0
+        if not bin_cfg.include or not bin_cfg.filename.exists() or weight <= 0.0:
+            if debug:
+                print(f"[INFO] Skipping bin {bin_cfg.name}.")
+            continue
+        if debug:
+            print(f"[DEBUG] Reading {bin_cfg.filename} with weight {weight}")
+
+        root_file = open_root_file(bin_cfg.filename)
+        try:
+            for full_name, key, cls in _iter_keys_recursively(root_file):
+                if not cls.InheritsFrom("TH1"):
+                    continue
+                plot = object_selected(full_name, plot_patterns)
+                write = object_selected(full_name, object_filter)
+                if not plot and not write:
+                    continue
+
+                obj = key.ReadObj()
+                if plot:
+                    plots.setdefault(full_name, []).append((bin_cfg, clone_and_scale_histogram(obj, bin_cfg)))
+                scale = 1.0 if is_bookkeeping(full_name) else weight
+                if full_name in sums:
+                    sums[full_name].Add(obj, scale)
+                else:
+                    hist = obj.Clone()
+                    hist.SetDirectory(0)
+                    # Errors of the scaled sum need the squared weights
+                    if hist.GetSumw2N() == 0:
+                        hist.Sumw2()
+                    hist.Scale(scale)
+                    sums[full_name] = hist
+                    if write:
+                        written.append(full_name)
+                obj.Delete()
+        finally:
+            root_file.Close()
+
+    if not plots:
+        raise RuntimeError(f"No histogram matching {','.join(plot_patterns)} found in the included bins.")
+    return plots, sums, written
+
+
+def write_sums(output_root: Path, sums: Dict[str, ROOT.TH1], names: List[str]) -> None:
+    ensure_parent_dir(output_root)
+    target_file = ROOT.TFile(str(output_root), "RECREATE")
+    if not target_file or target_file.IsZombie():
+        raise RuntimeError(f"Failed to create combined file {output_root}.")
+    for full_name in names:
+        dir_name = full_name.rpartition("/")[0]
+        if dir_name and not target_file.GetDirectory(dir_name):
+            target_file.mkdir(dir_name, "", True)
+        dst_dir = target_file.GetDirectory(dir_name) if dir_name else target_file
+        dst_dir.WriteTObject(sums[full_name], sums[full_name].GetName())
+    target_file.Close()
+
+
+# Plot jobs of draw_in_parallel, inherited by the forked workers
+_PLOT_JOBS: List[Tuple[str, List[Tuple[BinConfig, ROOT.TH1]], ROOT.TH1, Path]] = []
+
+
+def _draw_plot_job(index: int) -> str:
+    histogram_name, histograms_for_plot, combined_hist, output_pdf = _PLOT_JOBS[index]
+    draw_histograms(histogram_name, histograms_for_plot, combined_hist, output_pdf)
+    return str(output_pdf)
+
+
+def draw_in_parallel(
+    jobs: List[Tuple[str, List[Tuple[BinConfig, ROOT.TH1]], ROOT.TH1, Path]], workers: int
+) -> List[str]:
+    """Renders every plot job; forked workers share the histograms without pickling."""
+    global _PLOT_JOBS
+    _PLOT_JOBS = jobs
+    workers = min(workers, len(jobs))
+    if workers <= 1:
+        return [_draw_plot_job(index) for index in range(len(jobs))]
+    with multiprocessing.get_context("fork").Pool(workers) as pool:
+        return pool.map(_draw_plot_job, range(len(jobs)), chunksize=1)
+
+
+def run_batch(args: argparse.Namespace, bins: List[BinConfig], output_root: Path) -> None:
+    plot_patterns = parse_object_filter(args.histograms) or []
+    object_filter = parse_object_filter(args.objects)
+    plots, sums, written = load_bins_once(bins, plot_patterns, object_filter, debug=args.debug)
+    write_sums(output_root, sums, written)
+
+    jobs = []
+    for full_name, histograms_for_plot in plots.items():
+        plot_name = full_name.replace("/", "_")
+        output_pdf = output_root.with_name(f"{output_root.stem}_{plot_name}.pdf")
+        jobs.append((full_name, histograms_for_plot, sums[full_name], output_pdf))
+    rendered = draw_in_parallel(jobs, args.plot_workers)
+
+    if args.debug:
+        print(f"[INFO] Wrote {len(written)} histograms to {output_root}")
+        for output_pdf in rendered:
+            print(f"[INFO] Wrote comparison plot to {output_pdf}")
+
+
 def run_hadd(output_root: Path, scaled_files: List[Path], debug: bool = False) -> None:
     if not scaled_files:
         raise RuntimeError("No scaled ROOT files were produced; cannot run hadd.")
@@ -393,6 +638,48 @@ def run_hadd(output_root: Path, scaled_files: List[Path], debug: bool = False) -
     subprocess.run(cmd, check=True)
 
 
+def find_stitcher(requested: Optional[str]) -> Optional[str]:
+    if requested:
+        return requested
+    built = Path(__file__).resolve().parent.parent / "gen" / "stitchBins"
+    if built.is_file():
+        return str(built)
+    return shutil.which("stitchBins")
+
+
+def run_stitcher(
+    stitcher: str,
+    output_root: Path,
+    weighted_inputs: List[Tuple[Path, float]],
+    threads: int,
+    object_filter: Optional[List[str]] = None,
+    debug: bool = False,
+) -> None:
+    ensure_parent_dir(output_root)
+    # Weights as resolved from the config, so numeric scale_factors keep working
+    cmd = [stitcher, str(output_root)] + [f"{path}@{weight!r}" for path, weight in weighted_inputs]
+    cmd += ["--threads", str(threads)]
+    for pattern in object_filter or []:
+        cmd += ["--select", pattern]
+    if debug:
+        print(f"[DEBUG] Running: {' '.join(cmd)}")
+    subprocess.run(cmd, check=True)
+
+
+def run_hadd_of_copies(
+    output_root: Path,
+    weighted_inputs: List[Tuple[Path, float]],
+    object_filter: Optional[List[str]] = None,
+    debug: bool = False,
+) -> None:
+    with tempfile.TemporaryDirectory() as tmp_dir_str:
+        # Copies even at unit weight, so the trees stay out as with stitchBins
+        scaled_files = [
+            create_weighted_copy(path, weight, Path(tmp_dir_str), object_filter) for path, weight in weighted_inputs
+        ]
+        run_hadd(output_root=output_root, scaled_files=scaled_files, debug=debug)
+
+
 def main() -> None:
     args = parse_args()
     config_path = Path(args.config).resolve()
@@ -411,36 +698,41 @@ def main() -> None:
         print(f"[DEBUG] Using output directory: {output_dir}")
 
     bins = build_bin_configs(raw_config, input_dir=input_dir)
-    with tempfile.TemporaryDirectory() as tmp_dir_str:
-        tmp_dir = Path(tmp_dir_str)
-        (
-            histograms_for_plot,
-            selected_histogram,
-            scaled_files,
-            combined_hist,
-        ) = collect_histograms(
-            bins=bins,
-            histogram_to_draw=args.histogram,
-            temp_dir=tmp_dir,
-            debug=args.debug,
-        )
+    if args.histograms:
+        output_root = (output_dir / Path(args.output_name).name).resolve()
+        run_batch(args, bins, output_root)
+        return
+
+    (
+        histograms_for_plot,
+        selected_histogram,
+        weighted_inputs,
+        combined_hist,
+    ) = collect_histograms(
+        bins=bins,
+        histogram_to_draw=args.histogram,
+        debug=args.debug,
+    )
 
-        output_name = Path(args.output_name).name  # ensure we only keep the filename part
-        output_root = (output_dir / output_name).resolve()
-        output_pdf = output_root.with_suffix(".pdf")
+    output_name = Path(args.output_name).name  # ensure we only keep the filename part
+    output_root = (output_dir / output_name).resolve()
+    output_pdf = output_root.with_suffix(".pdf")
 
-        draw_histograms(
-            histogram_name=selected_histogram,
-            histograms_for_plot=histograms_for_plot,
-            combined_hist=combined_hist,
-            output_pdf=output_pdf,
-        )
+    draw_histograms(
+        histogram_name=selected_histogram,
+        histograms_for_plot=histograms_for_plot,
+        combined_hist=combined_hist,
+        output_pdf=output_pdf,
+    )
 
-        run_hadd(
-            output_root=output_root,
-            scaled_files=scaled_files,
-            debug=args.debug,
-        )
+    object_filter = parse_object_filter(args.objects)
+    stitcher = find_stitcher(args.stitcher)
+    if stitcher:
+        run_stitcher(stitcher, output_root, weighted_inputs, args.threads, object_filter, debug=args.debug)
+    else:
+        if args.debug:
+            print("[DEBUG] stitchBins not found; summing scaled copies with hadd.")
+        run_hadd_of_copies(output_root, weighted_inputs, object_filter, debug=args.debug)
 
     if args.debug:
         print(f"[INFO] Wrote combined ROOT file to {output_root}")